@@ -0,0 +1,138 @@
+// bufcache.cc
+//	Routines to manage the buffers of the disk sector cache: the hash
+//	table used to find a sector, and the LRU list used to choose a
+//	buffer to recycle.  See bufcache.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "bufcache.h"
+
+//----------------------------------------------------------------------
+// BufferCache::BufferCache
+// 	Initialize a cache with NumCacheBuffers empty buffers, all on
+//	the LRU list.
+//----------------------------------------------------------------------
+
+BufferCache::BufferCache()
+{
+    int i;
+
+    buffers = new CacheBuffer[NumCacheBuffers];
+    buckets = new CacheBuffer *[CacheHashBuckets];
+    for (i = 0; i < CacheHashBuckets; i++)
+	buckets[i] = NULL;
+    for (i = 0; i < NumCacheBuffers; i++) {
+	buffers[i].sector = -1;
+	buffers[i].valid = FALSE;
+	buffers[i].dirty = FALSE;
+	buffers[i].pinCount = 0;
+	buffers[i].busy = FALSE;
+	buffers[i].held = FALSE;
+	buffers[i].hashNext = NULL;
+	buffers[i].prev = (i > 0) ? &buffers[i - 1] : NULL;
+	buffers[i].next = (i < NumCacheBuffers - 1) ? &buffers[i + 1] : NULL;
+    }
+    mru = &buffers[0];
+    lru = &buffers[NumCacheBuffers - 1];
+}
+
+BufferCache::~BufferCache()
+{
+    delete [] buckets;
+    delete [] buffers;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Find
+// 	Look "sector" up in the hash table.
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Find(int sector)
+{
+    for (CacheBuffer *buf = buckets[Hash(sector)]; buf != NULL;
+						buf = buf->hashNext)
+	if (buf->sector == sector)
+	    return buf;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Victim
+// 	Walk the LRU list from the cold end, skipping pinned buffers
+//	and buffers with I/O in progress.
+//	The caller must write the buffer back if it is dirty before
+//	reusing it.
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Victim()
+{
+    for (CacheBuffer *buf = lru; buf != NULL; buf = buf->prev)
+	if (buf->pinCount == 0 && !buf->busy)
+	    return buf;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Unhash
+// 	Remove "buf" from the hash chain of the sector it holds.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Unhash(CacheBuffer *buf)
+{
+    CacheBuffer **p;
+
+    if (!buf->valid)
+	return;
+    for (p = &buckets[Hash(buf->sector)]; *p != buf; p = &(*p)->hashNext)
+	ASSERT(*p != NULL);
+    *p = buf->hashNext;
+    buf->hashNext = NULL;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Rename
+// 	Re-key "buf" under "sector".  Its contents are left alone; the
+//	caller fills them in.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Rename(CacheBuffer *buf, int sector)
+{
+    int bucket = Hash(sector);
+
+    Unhash(buf);
+    buf->sector = sector;
+    buf->valid = TRUE;
+    buf->dirty = FALSE;
+    buf->hashNext = buckets[bucket];
+    buckets[bucket] = buf;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Touch
+// 	Move "buf" to the hot end of the LRU list.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Touch(CacheBuffer *buf)
+{
+    if (buf == mru)
+	return;
+    // unlink
+    buf->prev->next = buf->next;
+    if (buf->next != NULL)
+	buf->next->prev = buf->prev;
+    else
+	lru = buf->prev;
+    // relink at the front
+    buf->prev = NULL;
+    buf->next = mru;
+    mru->prev = buf;
+    mru = buf;
+}
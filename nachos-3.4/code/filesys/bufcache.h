@@ -0,0 +1,79 @@
+// bufcache.h
+//	Data structures for the disk sector buffer cache.
+//
+//	The cache holds copies of recently used disk sectors in memory.
+//	Buffers are found by sector number through a hash table, and
+//	kept on a list in order of use, so that the least recently used
+//	buffer is the one recycled on a miss.  A buffer can be pinned to
+//	keep it in the cache (e.g., the headers of the directory and free
+//	map files).
+//
+//	This is only the bookkeeping; the disk I/O -- filling buffers,
+//	writing dirty ones back -- is done by SynchDisk, which owns the
+//	cache.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef BUFCACHE_H
+#define BUFCACHE_H
+
+#include "utility.h"
+#include "disk.h"
+
+#define NumCacheBuffers		64	// sectors held in memory
+#define CacheHashBuckets	31	// number of hash chains
+
+// The following class defines one buffer of the cache.
+
+class CacheBuffer {
+  public:
+    int sector;			// disk sector held, if valid
+    bool valid;			// does "data" hold a sector?
+    bool dirty;			// modified since read from disk?
+    int pinCount;		// pinned buffers are never recycled
+    bool busy;			// being read or written right now
+    bool held;			// changed by a transaction that is not
+				// committed yet; must not go to disk
+    char data[SectorSize];	// the contents of the sector
+
+    CacheBuffer *hashNext;	// next buffer on the same hash chain
+    CacheBuffer *prev;		// neighbours in LRU order; the list
+    CacheBuffer *next;		// runs from most to least recently used
+};
+
+// The following class defines the cache itself.
+
+class BufferCache {
+  public:
+    BufferCache();		// Initialize a cache of empty buffers
+    ~BufferCache();
+
+    CacheBuffer *Find(int sector);	// Return the buffer holding
+					// "sector", or NULL
+    CacheBuffer *Victim();		// Return the least recently used
+					// unpinned, idle buffer, or NULL
+					// if there is none
+    void Rename(CacheBuffer *buf, int sector);
+					// Make "buf" hold "sector" instead
+					// of whatever it held before
+    void Touch(CacheBuffer *buf);	// "buf" has just been used
+
+    int NumBuffers() { return NumCacheBuffers; }
+    CacheBuffer *Buffer(int i) { return &buffers[i]; }
+					// For scanning every buffer
+
+  private:
+    int Hash(int sector) { return sector % CacheHashBuckets; }
+    void Unhash(CacheBuffer *buf);	// Take "buf" off its hash chain
+
+    CacheBuffer *buffers;		// all the buffers
+    CacheBuffer **buckets;		// hash chains of valid buffers
+    CacheBuffer *mru;			// head of the LRU list
+    CacheBuffer *lru;			// tail of the LRU list
+};
+
+#endif // BUFCACHE_H
@@ -1,23 +1,26 @@
-// directory.cc 
+// directory.cc
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
-//	entry represents a single file, and contains the file name,
-//	and the location of the file header on disk.  The fixed size
-//	of each directory entry means that we have the restriction
-//	of a fixed maximum size for file names.
+//	The directory is a table of entries; each entry represents a
+//	single file, and contains the file name, whether the file is
+//	itself a directory, and the location of the file header on disk.
+//	On disk each entry has a record, which stays where it is until
+//	the entry is removed; in memory the entries are kept both in
+//	file order and on hash chains, keyed by name.  Only the records
+//	that Add and Remove change are written back.
 //
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	The directory file grows as entries are added (cf. OpenFile::
+//	WriteAt), so there is no limit on the number of files in it.
+//
+//	At the end of the file is the cache of name lookups used in
+//	resolving paths.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -28,19 +31,36 @@
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
-//	empty.  If the disk is being formatted, an empty directory
-//	is all we need, but otherwise, we need to call FetchFrom in order
-//	to initialize it from disk.
+//	empty: one free record covering the whole file.  If the disk is
+//	being formatted, an empty directory is all we need, but
+//	otherwise, we need to call FetchFrom in order to initialize it
+//	from disk.
 //
-//	"size" is the number of entries in the directory
+//	"fileSize" is the number of bytes the directory file holds
 //----------------------------------------------------------------------
 
-Directory::Directory(int size)
+Directory::Directory(int fileSize)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    size = 0;
+    numEntries = 0;
+    numBuckets = DirHashBuckets;
+    buckets = new DirectoryEntry *[numBuckets];
+    for (int i = 0; i < numBuckets; i++)
+	buckets[i] = NULL;
+    firstRec = lastRec = NULL;
+    dirtyStart = dirtyEnd = 0;
+    if (fileSize >= RecordSize(0)) {
+	DirectoryEntry *e = new DirectoryEntry;
+	e->sector = -1;
+	e->isDir = FALSE;
+	e->name = NULL;
+	e->next = NULL;
+	e->pos = 0;
+	e->recLen = fileSize;
+	LinkRecord(e, NULL);
+	size = fileSize;
+	Touch(0, RecordSize(0));
+    }
 }
 
 //----------------------------------------------------------------------
@@ -49,13 +69,159 @@ Directory::Directory(int size)
 //----------------------------------------------------------------------
 
 Directory::~Directory()
-{ 
-    delete [] table;
-} 
+{
+    Clear();
+    delete [] buckets;
+}
+
+//----------------------------------------------------------------------
+// Directory::Clear
+// 	Delete every record, leaving no entries.
+//----------------------------------------------------------------------
+
+void
+Directory::Clear()
+{
+    while (firstRec != NULL) {
+	DirectoryEntry *e = firstRec;
+	firstRec = e->nextRec;
+	delete [] e->name;
+	delete e;
+    }
+    lastRec = NULL;
+    for (int i = 0; i < numBuckets; i++)
+	buckets[i] = NULL;
+    numEntries = 0;
+    size = 0;
+}
+
+//----------------------------------------------------------------------
+// Directory::Hash
+// 	Choose the hash chain for "name".
+//----------------------------------------------------------------------
+
+int
+Directory::Hash(char *name)
+{
+    unsigned int h = 0;
+
+    while (*name != '\0')
+	h = h * 31 + (unsigned char) *name++;
+    return h & (numBuckets - 1);
+}
+
+//----------------------------------------------------------------------
+// Directory::Grow
+// 	Double the number of hash chains, and redistribute the entries,
+//	so that the chains stay short however big the directory gets.
+//----------------------------------------------------------------------
+
+void
+Directory::Grow()
+{
+    DirectoryEntry **oldBuckets = buckets;
+    int oldNumBuckets = numBuckets;
+
+    numBuckets *= 2;
+    buckets = new DirectoryEntry *[numBuckets];
+    for (int i = 0; i < numBuckets; i++)
+	buckets[i] = NULL;
+    for (int i = 0; i < oldNumBuckets; i++) {
+	DirectoryEntry *e = oldBuckets[i];
+	while (e != NULL) {
+	    DirectoryEntry *next = e->next;
+	    int bucket = Hash(e->name);
+	    e->next = buckets[bucket];
+	    buckets[bucket] = e;
+	    e = next;
+	}
+    }
+    delete [] oldBuckets;
+}
+
+//----------------------------------------------------------------------
+// Directory::Insert
+// 	Put a new entry on its hash chain, and return it; the caller
+//	gives it its record.  The caller has checked that the name is
+//	not already there.
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::Insert(char *name, int sector, bool isDir)
+{
+    DirectoryEntry *e = new DirectoryEntry;
+    int bucket;
+
+    if (numEntries >= 2 * numBuckets)
+	Grow();
+    bucket = Hash(name);
+    e->sector = sector;
+    e->isDir = isDir;
+    e->name = new char[strlen(name) + 1];
+    strcpy(e->name, name);
+    e->next = buckets[bucket];
+    buckets[bucket] = e;
+    numEntries++;
+    return e;
+}
+
+//----------------------------------------------------------------------
+// Directory::LinkRecord/UnlinkRecord
+// 	Put record "e" into the file order, right after "after" (first,
+//	if "after" is NULL); or take it out.
+//----------------------------------------------------------------------
+
+void
+Directory::LinkRecord(DirectoryEntry *e, DirectoryEntry *after)
+{
+    e->prevRec = after;
+    e->nextRec = (after == NULL) ? firstRec : after->nextRec;
+    if (e->nextRec != NULL)
+	e->nextRec->prevRec = e;
+    else
+	lastRec = e;
+    if (after != NULL)
+	after->nextRec = e;
+    else
+	firstRec = e;
+}
+
+void
+Directory::UnlinkRecord(DirectoryEntry *e)
+{
+    if (e->prevRec != NULL)
+	e->prevRec->nextRec = e->nextRec;
+    else
+	firstRec = e->nextRec;
+    if (e->nextRec != NULL)
+	e->nextRec->prevRec = e->prevRec;
+    else
+	lastRec = e->prevRec;
+}
+
+//----------------------------------------------------------------------
+// Directory::Touch
+// 	Note that bytes ["start", "end") of the file have changed, and
+//	must be written back.
+//----------------------------------------------------------------------
+
+void
+Directory::Touch(int start, int end)
+{
+    if (dirtyStart >= dirtyEnd) {
+	dirtyStart = start;
+	dirtyEnd = end;
+    } else {
+	dirtyStart = min(dirtyStart, start);
+	dirtyEnd = max(dirtyEnd, end);
+    }
+}
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  Reading stops at
+//	anything that is not a proper record; what follows is lost, and
+//	will be overwritten as entries are added.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -63,12 +229,46 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int length = file->Length();
+    char *buf = new char[max(length, 1)];
+    char name[FileNameMaxLen + 1];
+    int sector, recLen, len, pos;
+    DirectoryEntry *e;
+
+    Clear();
+    (void) file->ReadAt(buf, length, 0);
+    for (pos = 0; pos + RecordSize(0) <= length; pos += recLen) {
+	bcopy(&buf[pos], (char *) &sector, sizeof(int));
+	bcopy(&buf[pos + sizeof(int)], (char *) &recLen, sizeof(int));
+	len = (unsigned char) buf[pos + 2 * sizeof(int) + 1];
+	if (recLen < RecordSize(sector == -1 ? 0 : len)
+		|| recLen > length - pos || (sector == -1 && pos != 0))
+	    break;				// not a record
+	if (sector == -1) {
+	    e = new DirectoryEntry;
+	    e->sector = -1;
+	    e->isDir = FALSE;
+	    e->name = NULL;
+	    e->next = NULL;
+	} else {
+	    bcopy(&buf[pos + RecordSize(0)], name, len);
+	    name[len] = '\0';
+	    e = Insert(name, sector, buf[pos + 2 * sizeof(int)] != 0);
+	}
+	e->pos = pos;
+	e->recLen = recLen;
+	LinkRecord(e, lastRec);
+    }
+    size = pos;
+    dirtyStart = dirtyEnd = 0;
+    delete [] buf;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write the bytes of the directory that have changed since it was
+//	fetched or last written back: the records that Add and Remove
+//	touched.  Bytes in between that belong to no entry are zeroed.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -76,30 +276,56 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    char rec[RecordSize(FileNameMaxLen)];
+    int numBytes = dirtyEnd - dirtyStart;
+    char *buf;
+
+    if (numBytes <= 0)
+	return;
+    buf = new char[numBytes];
+    bzero(buf, numBytes);
+    for (DirectoryEntry *e = firstRec; e != NULL && e->pos < dirtyEnd;
+						e = e->nextRec) {
+	int len = (e->name == NULL) ? 0 : strlen(e->name);
+	int start = max(e->pos, dirtyStart);
+	int end = min(e->pos + RecordSize(len), dirtyEnd);
+
+	if (start >= end)
+	    continue;
+	bcopy((char *) &e->sector, rec, sizeof(int));
+	bcopy((char *) &e->recLen, &rec[sizeof(int)], sizeof(int));
+	rec[2 * sizeof(int)] = e->isDir;
+	rec[2 * sizeof(int) + 1] = len;
+	if (len > 0)
+	    bcopy(e->name, &rec[RecordSize(0)], len);
+	bcopy(&rec[start - e->pos], &buf[start - dirtyStart], end - start);
+    }
+    (void) file->WriteAt(buf, numBytes, dirtyStart);
+    dirtyStart = dirtyEnd = 0;
+    delete [] buf;
 }
 
 //----------------------------------------------------------------------
-// Directory::FindIndex
-// 	Look up file name in directory, and return its location in the table of
-//	directory entries.  Return -1 if the name isn't in the directory.
+// Directory::FindEntry
+// 	Look up file name in directory, and return its entry.  Return
+//	NULL if the name isn't in the directory.
 //
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
 
-int
-Directory::FindIndex(char *name)
+DirectoryEntry *
+Directory::FindEntry(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
-    return -1;		// name not in directory
+    for (DirectoryEntry *e = buckets[Hash(name)]; e != NULL; e = e->next)
+	if (!strcmp(e->name, name))
+	    return e;
+    return NULL;		// name not in directory
 }
 
 //----------------------------------------------------------------------
 // Directory::Find
 // 	Look up file name in directory, and return the disk sector number
-//	where the file's header is stored. Return -1 if the name isn't 
+//	where the file's header is stored. Return -1 if the name isn't
 //	in the directory.
 //
 //	"name" -- the file name to look up
@@ -108,70 +334,154 @@ Directory::FindIndex(char *name)
 int
 Directory::Find(char *name)
 {
-    int i = FindIndex(name);
+    DirectoryEntry *e = FindEntry(name);
 
-    if (i != -1)
-	return table[i].sector;
+    if (e != NULL)
+	return e->sector;
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::IsDirectory
+// 	Return TRUE if "name" is in the directory, and is a directory.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsDirectory(char *name)
+{
+    DirectoryEntry *e = FindEntry(name);
+
+    return e != NULL && e->isDir;
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
 //	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	the name is empty or too long.  There is always room: the new
+//	record goes in the first free space big enough -- the free first
+//	record, or the slack after some entry -- or else at the end,
+//	making the directory file longer.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
-{ 
-    if (FindIndex(name) != -1)
+Directory::Add(char *name, int newSector, bool isDir)
+{
+    int len = strlen(name);
+    int need = RecordSize(len);
+    DirectoryEntry *r, *e;
+    int used;
+
+    if (len == 0 || len > FileNameMaxLen || strchr(name, '/') != NULL)
 	return FALSE;
+    if (FindEntry(name) != NULL)
+	return FALSE;
+    for (r = firstRec; r != NULL; r = r->nextRec) {
+	used = (r->sector == -1) ? 0 : RecordSize(strlen(r->name));
+	if (r->recLen - used >= need)
+	    break;
+    }
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    e = Insert(name, newSector, isDir);
+    if (r == NULL) {			// at the end
+	e->pos = size;
+	e->recLen = need;
+	LinkRecord(e, lastRec);
+	size += need;
+    } else if (r->sector == -1) {	// in place of the free record
+	e->pos = r->pos;
+	e->recLen = r->recLen;
+	LinkRecord(e, r->prevRec);
+	UnlinkRecord(r);
+	delete r;
+    } else {				// in the slack after "r"
+	e->pos = r->pos + used;
+	e->recLen = r->recLen - used;
+	r->recLen = used;
+	LinkRecord(e, r);
+	Touch(r->pos, r->pos + RecordSize(0));
+    }
+    Touch(e->pos, e->pos + need);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // Directory::Remove
 // 	Remove a file name from the directory.  Return TRUE if successful;
-//	return FALSE if the file isn't in the directory. 
+//	return FALSE if the file isn't in the directory.  Its record is
+//	merged into the one before it, or if it is the first, made free.
 //
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
 bool
 Directory::Remove(char *name)
-{ 
-    int i = FindIndex(name);
+{
+    DirectoryEntry **p, *e, *prev;
 
-    if (i == -1)
+    for (p = &buckets[Hash(name)]; *p != NULL; p = &(*p)->next)
+	if (!strcmp((*p)->name, name))
+	    break;
+    if (*p == NULL)
 	return FALSE; 		// name not in directory
-    table[i].inUse = FALSE;
-    return TRUE;	
+
+    e = *p;
+    *p = e->next;
+    numEntries--;
+    delete [] e->name;
+    e->name = NULL;
+    prev = e->prevRec;
+    if (prev != NULL) {
+	prev->recLen += e->recLen;
+	Touch(prev->pos, prev->pos + RecordSize(0));
+	UnlinkRecord(e);
+	delete e;
+    } else {
+	e->sector = -1;
+	e->isDir = FALSE;
+	e->next = NULL;
+	Touch(e->pos, e->pos + RecordSize(0));
+    }
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory; directories have a
+//	'/' after their names.
 //----------------------------------------------------------------------
 
 void
 Directory::List()
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+    for (int i = 0; i < numBuckets; i++)
+	for (DirectoryEntry *e = buckets[i]; e != NULL; e = e->next)
+	    printf("%s%s\n", e->name, e->isDir ? "/" : "");
+}
+
+//----------------------------------------------------------------------
+// Directory::Subdirectories
+// 	Fill in "names" (with copies, for the caller to delete) and
+//	"sectors" for the entries that are directories, and set "*count"
+//	to how many there are.  The arrays must have room for every
+//	entry.
+//----------------------------------------------------------------------
+
+void
+Directory::Subdirectories(char **names, int *sectors, int *count)
+{
+    *count = 0;
+    for (int i = 0; i < numBuckets; i++)
+	for (DirectoryEntry *e = buckets[i]; e != NULL; e = e->next)
+	    if (e->isDir) {
+		names[*count] = new char[strlen(e->name) + 1];
+		strcpy(names[*count], e->name);
+		sectors[(*count)++] = e->sector;
+	    }
 }
 
 //----------------------------------------------------------------------
@@ -182,16 +492,95 @@ Directory::List()
 
 void
 Directory::Print()
-{ 
+{
     FileHeader *hdr = new FileHeader;
 
     printf("Directory contents:\n");
-    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
-	    hdr->FetchFrom(table[i].sector);
+    for (int i = 0; i < numBuckets; i++)
+	for (DirectoryEntry *e = buckets[i]; e != NULL; e = e->next) {
+	    printf("Name: %s%s, Sector: %d\n", e->name, e->isDir ? "/" : "",
+							e->sector);
+	    hdr->FetchFrom(e->sector);
 	    hdr->Print();
 	}
     printf("\n");
     delete hdr;
 }
+
+//----------------------------------------------------------------------
+// DirCache::DirCache
+// 	Initialize an empty cache of name lookups.
+//----------------------------------------------------------------------
+
+DirCache::DirCache()
+{
+    for (int i = 0; i < DirCacheSize; i++)
+	slots[i].dirSector = -1;
+}
+
+//----------------------------------------------------------------------
+// DirCache::Hash
+// 	Choose the slot for "name" in the directory at "dirSector".
+//----------------------------------------------------------------------
+
+int
+DirCache::Hash(int dirSector, char *name)
+{
+    unsigned int h = dirSector;
+
+    while (*name != '\0')
+	h = h * 31 + (unsigned char) *name++;
+    return h % DirCacheSize;
+}
+
+//----------------------------------------------------------------------
+// DirCache::Lookup
+// 	Return the header sector of "name" in the directory at
+//	"dirSector", and whether it is a directory, if the cache has
+//	it.  Otherwise return -1; the caller must read the directory.
+//----------------------------------------------------------------------
+
+int
+DirCache::Lookup(int dirSector, char *name, bool *isDir)
+{
+    DirCacheEntry *slot = &slots[Hash(dirSector, name)];
+
+    if (slot->dirSector != dirSector || strcmp(slot->name, name))
+	return -1;
+    *isDir = slot->isDir;
+    return slot->sector;
+}
+
+//----------------------------------------------------------------------
+// DirCache::Enter
+// 	Remember that "name" in the directory at "dirSector" has its
+//	header at "sector", displacing whatever shared its slot.
+//----------------------------------------------------------------------
+
+void
+DirCache::Enter(int dirSector, char *name, int sector, bool isDir)
+{
+    DirCacheEntry *slot = &slots[Hash(dirSector, name)];
+
+    if (strlen(name) > FileNameMaxLen)
+	return;
+    slot->dirSector = dirSector;
+    slot->sector = sector;
+    slot->isDir = isDir;
+    strcpy(slot->name, name);
+}
+
+//----------------------------------------------------------------------
+// DirCache::Remove
+// 	"name" is being removed from the directory at "dirSector"; make
+//	sure the cache no longer has it.
+//----------------------------------------------------------------------
+
+void
+DirCache::Remove(int dirSector, char *name)
+{
+    DirCacheEntry *slot = &slots[Hash(dirSector, name)];
+
+    if (slot->dirSector == dirSector && !strcmp(slot->name, name))
+	slot->dirSector = -1;
+}
@@ -1,15 +1,25 @@
-// directory.h 
+// directory.h
 //	Data structures to manage a UNIX-like directory of file names.
-// 
+//
 //      A directory is a table of pairs: <file name, sector #>,
-//	giving the name of each file in the directory, and 
+//	giving the name of each file in the directory, and
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry may
+//	itself be a directory, so directories form a tree, rooted at
+//	the directory whose header is in a well-known sector.
+//
+//	Names can be up to FileNameMaxLen characters long.  In memory,
+//	the entries are kept in a hash table, so looking a name up does
+//	not depend on the size of the directory.
+//
+//	A path is a list of names separated by '/'.  The DirCache
+//	remembers the results of looking names up along paths, so that
+//	resolving a path does not have to read every directory on it.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -19,52 +29,81 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		255	// longest name of a file
+#define DirHashBuckets		16	// initial hash chains per directory
+#define DirCacheSize		128	// slots in the lookup cache
 
 // The following class defines a "directory entry", representing a file
-// in the directory.  Each entry gives the name of the file, and where
-// the file's header is to be found on disk.
+// in the directory.  Each entry gives the name of the file, whether it
+// is a directory, and where the file's header is to be found on disk.
 //
 // Internal data structures kept public so that Directory operations can
 // access them directly.
+//
+// On disk, the directory file is a sequence of records, one per entry,
+// each at a fixed place: the sector, the length of the record, a byte
+// telling if it is a directory, a byte with the length of the name,
+// and the name itself (without a trailing '\0').  A record may be
+// longer than its entry needs; the slack is free space, where a later
+// entry can go.  Only the first record can be free altogether (its
+// sector is -1): a removed entry's record is merged into the one
+// before it.  So adding or removing an entry changes one or two
+// records, and only the sectors holding those are written back.
 
 class DirectoryEntry {
   public:
-    bool inUse;				// Is this directory entry in use?
-    int sector;				// Location on disk to find the 
-					//   FileHeader for this file 
-    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
-					// the trailing '\0'
+    int sector;				// Location on disk to find the
+					//   FileHeader for this file; -1
+					//   for a free record
+    bool isDir;				// Is the file a directory?
+    char *name;				// Text name for file
+    DirectoryEntry *next;		// Next entry on the same hash chain
+
+    int pos;				// Where its record is in the file
+    int recLen;				// Bytes the record takes there
+    DirectoryEntry *prevRec;		// Records before and after it in
+    DirectoryEntry *nextRec;		//   the file
 };
 
+#define DirRecordHeader		(2 * sizeof(int) + 2)
+#define RecordSize(nameLen)	((int) DirRecordHeader + (nameLen))
+
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file of records
+// (cf. DirectoryEntry).  The directory remembers which bytes of the
+// file its changes have touched, and WriteBack writes just those.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.
 
 class Directory {
   public:
-    Directory(int size); 		// Initialize an empty directory
-					// with space for "size" files
+    Directory(int fileSize); 		// Initialize an empty directory of
+					// "fileSize" bytes
     ~Directory();			// De-allocate the directory
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
-    void WriteBack(OpenFile *file);	// Write modifications to 
-					// directory contents back to disk
+    void WriteBack(OpenFile *file);	// Write the records that changed
+					// back to disk
 
-    int Find(char *name);		// Find the sector number of the 
+    int Find(char *name);		// Find the sector number of the
 					// FileHeader for file: "name"
+    bool IsDirectory(char *name);	// Is "name" a directory?
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDir);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
+    int NumEntries() { return numEntries; }
+    void Subdirectories(char **names, int *sectors, int *count);
+					// Copy out the names and sectors
+					// of the directories in this one
+
     void List();			// Print the names of all the files
 					//  in the directory
     void Print();			// Verbose print of the contents
@@ -72,12 +111,60 @@ class Directory {
 					//  names and their contents.
 
   private:
-    int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
+    int size;				// Bytes of the file the records cover
+    int numEntries;			// Number of directory entries
+    int numBuckets;			// Hash chains; a power of two
+    DirectoryEntry **buckets;		// Hash table of entries
+    DirectoryEntry *firstRec;		// Every record, free or not, in
+    DirectoryEntry *lastRec;		//   the order of the file
+    int dirtyStart, dirtyEnd;		// Bytes changed since the last
+					//   FetchFrom or WriteBack
+
+    int Hash(char *name);		// Choose the chain for "name"
+    void Grow();			// Double the number of chains
+    DirectoryEntry *Insert(char *name, int sector, bool isDir);
+					// Put an entry in the hash table
+    DirectoryEntry *FindEntry(char *name);
+					// Find the entry for "name"
+    void LinkRecord(DirectoryEntry *e, DirectoryEntry *after);
+    void UnlinkRecord(DirectoryEntry *e);
+					// Put a record in the file order,
+					// or take it out
+    void Clear();			// Delete every record
+    void Touch(int start, int end);	// Note bytes that need writing
+};
+
+// One slot of the lookup cache: "name" in the directory whose header
+// is at "dirSector" is the file whose header is at "sector".
 
-    int FindIndex(char *name);		// Find the index into the directory 
-					//  table corresponding to "name"
+class DirCacheEntry {
+  public:
+    int dirSector;			// -1 if the slot is empty
+    int sector;
+    bool isDir;
+    char name[FileNameMaxLen + 1];
+};
+
+// The following class defines a cache of name lookups, indexed by
+// <directory, name>.  Each pair hashes to a single slot, so a lookup
+// or an update is a single probe; a new entry simply replaces the old
+// one in its slot.
+
+class DirCache {
+  public:
+    DirCache();
+
+    int Lookup(int dirSector, char *name, bool *isDir);
+					// Return the sector of "name", or -1
+					// if the lookup is not cached
+    void Enter(int dirSector, char *name, int sector, bool isDir);
+					// Remember a lookup
+    void Remove(int dirSector, char *name);
+					// Forget a name that is going away
+
+  private:
+    int Hash(int dirSector, char *name);
+    DirCacheEntry slots[DirCacheSize];
 };
 
 #endif // DIRECTORY_H
@@ -3,12 +3,11 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a list of extents
+//	-- each one a run of consecutive disk sectors holding that
+//	portion of the file data.  The first few extents are in the file 
+//	header, which is just big enough to fit in one disk sector; the
+//	rest go in single and double indirect blocks.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,49 +26,237 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header; Allocate or FetchFrom fills it.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    numBytes = numSectors = numExtents = 0;
+    indirect = doubleIndirect = -1;
+    table = NULL;
+    blocks = NULL;
+}
+
+FileHeader::~FileHeader()
+{
+    delete [] table;
+    delete [] blocks;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NumIndirectBlocks
+// 	Return how many indirect blocks the double indirect block must
+//	point to, to hold "n" extents.
+//----------------------------------------------------------------------
+
+int
+FileHeader::NumIndirectBlocks(int n)
+{
+    int rest = n - NumDirect - ExtentsPerBlock;
+
+    return (rest > 0) ? divRoundUp(rest, ExtentsPerBlock) : 0;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
-// 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
+// 	Initialize a fresh file header for a newly created file, and
+//	allocate "fileSize" bytes worth of data blocks for it (cf. Extend),
+//	searching from the file header onwards.
 //	Return FALSE if there are not enough free blocks to accomodate
-//	the new file.
+//	the new file (or they are too fragmented).
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the number of bytes in the file
+//	"near" is the sector of the file header
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize)
+FileHeader::Allocate(FreeMap *freeMap, int fileSize, int near)
 { 
+    numBytes = numSectors = numExtents = 0;
+    indirect = doubleIndirect = -1;
+    delete [] table;
+    delete [] blocks;
+    table = NULL;
+    blocks = NULL;
+    if (!Extend(freeMap, divRoundUp(fileSize, SectorSize), near))
+	return FALSE;
     numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
-	return FALSE;		// not enough space
+    return TRUE;
+}
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->Find();
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Add "count" data blocks to the end of the file, out of the map
+//	of free disk blocks, as few extents as possible: each extent is
+//	the first free run that holds the rest, or failing that the
+//	longest free run (cf. FreeMap::FindRun).  The search starts just
+//	past the last block of the file, so that if the space there is
+//	free the last extent simply gets longer.  Then allocate whatever
+//	indirect blocks are needed to list the extents.
+//
+//	The length of the file in bytes is left alone; the new blocks
+//	are room for the caller to grow the file into (cf. SetLength).
+//	Return FALSE, with nothing changed, if there are not enough free 
+//	blocks (or they are too fragmented).
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"count" is the number of blocks to add
+//	"near" is where to start looking, if the file has no blocks yet
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(FreeMap *freeMap, int count, int near)
+{
+    Extent *extents = new Extent[MaxExtents];
+    Extent *added = new Extent[MaxExtents];
+    int n = numExtents, numAdded = 0, oldBlocks, numBlocks;
+    int left, i, j, start, length;
+
+    for (i = 0; i < numExtents; i++)
+	extents[i] = table[i];
+    if (n > 0)
+	near = extents[n - 1].start + extents[n - 1].length;
+
+    left = count;
+    if (freeMap->NumClear() >= count)
+	for (; left > 0; left -= length) {
+	    length = freeMap->FindRun(left, near, &start);
+	    if (length == 0)
+		break;
+	    if (n > 0 && extents[n - 1].start + extents[n - 1].length == start)
+		extents[n - 1].length += length;	// contiguous; merge
+	    else if (n < MaxExtents) {
+		extents[n].start = start;
+		extents[n].length = length;
+		n++;
+	    } else
+		break;
+	    for (j = 0; j < length; j++)
+		freeMap->Mark(start + j);
+	    added[numAdded].start = start;
+	    added[numAdded++].length = length;
+	    near = start + length;
+	}
+
+    oldBlocks = NumIndirectBlocks(numExtents);
+    if (numExtents > NumDirect)
+	oldBlocks++;				// single indirect
+    if (oldBlocks > 1)
+	oldBlocks++;				// double indirect
+    numBlocks = NumIndirectBlocks(n);
+    if (n > NumDirect)
+	numBlocks++;
+    if (numBlocks > 1)
+	numBlocks++;
+    if (left > 0 || freeMap->NumClear() < numBlocks - oldBlocks) {
+	for (i = 0; i < numAdded; i++)		// too fragmented; undo
+	    for (j = 0; j < added[i].length; j++)
+		freeMap->Clear(added[i].start + j);
+	delete [] extents;
+	delete [] added;
+	return FALSE;
+    }
+    delete [] added;
+
+    if (n > NumDirect && indirect == -1)
+	indirect = freeMap->Find(near);
+    if (NumIndirectBlocks(n) > 0 && doubleIndirect == -1) {
+	doubleIndirect = freeMap->Find(near);
+	blocks = new int[PointersPerBlock];
+	bzero((char *)blocks, SectorSize);	// it goes to disk whole
+    }
+    for (i = NumIndirectBlocks(numExtents); i < NumIndirectBlocks(n); i++)
+	blocks[i] = freeMap->Find(near);
+
+    delete [] table;
+    table = new Extent[n];
+    for (i = 0; i < n; i++)
+	table[i] = extents[i];
+    delete [] extents;
+    numExtents = n;
+    numSectors += count;
+    DEBUG('f', "Added %d sectors, now %d sectors in %d extents\n", count,
+	  numSectors, numExtents);
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for its indirect blocks.  They are not reused until the
+//	removal has committed (cf. FreeMap::Free).
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
 
 void 
-FileHeader::Deallocate(BitMap *freeMap)
+FileHeader::Deallocate(FreeMap *freeMap)
+{
+    int i, j;
+
+    for (i = 0; i < numExtents; i++)
+	for (j = 0; j < table[i].length; j++) {
+	    ASSERT(freeMap->Test(table[i].start + j));  // ought to be marked!
+	    freeMap->Free(table[i].start + j);
+	}
+    if (indirect != -1)
+	freeMap->Free(indirect);
+    if (doubleIndirect != -1) {
+	for (i = 0; i < NumIndirectBlocks(numExtents); i++)
+	    freeMap->Free(blocks[i]);
+	freeMap->Free(doubleIndirect);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Shrink
+// 	De-allocate the data blocks past the end of the file -- room that
+//	Extend gave it to grow into, and that it did not use -- and the
+//	indirect blocks that are no longer needed to list the extents.
+//	Like Deallocate, the sectors are not reused until the change has
+//	committed.
+//
+//	"freeMap" is the bit map of free disk sectors
+//----------------------------------------------------------------------
+
+void
+FileHeader::Shrink(FreeMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    int keep = divRoundUp(numBytes, SectorSize);
+    int n = numExtents, i;
+
+    while (numSectors > keep) {
+	Extent *last = &table[n - 1];
+	int cut = min(last->length, numSectors - keep);
+	for (i = last->length - cut; i < last->length; i++)
+	    freeMap->Free(last->start + i);
+	last->length -= cut;
+	numSectors -= cut;
+	if (last->length == 0)
+	    n--;
     }
+    for (i = NumIndirectBlocks(n); i < NumIndirectBlocks(numExtents); i++)
+	freeMap->Free(blocks[i]);
+    if (NumIndirectBlocks(n) == 0 && doubleIndirect != -1) {
+	freeMap->Free(doubleIndirect);
+	doubleIndirect = -1;
+	delete [] blocks;
+	blocks = NULL;
+    }
+    if (n <= NumDirect && indirect != -1) {
+	freeMap->Free(indirect);
+	indirect = -1;
+    }
+    numExtents = n;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk, along with the extents
+//	in its indirect blocks.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -77,12 +264,38 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    Extent *block = new Extent[ExtentsPerBlock];
+    int i, n;
+
+    delete [] table;
+    delete [] blocks;
+    synchDisk->ReadSector(sector, (char *)this);	// the on-disk part
+    table = new Extent[numExtents];
+    blocks = NULL;
+    for (i = 0; i < numExtents && i < NumDirect; i++)
+	table[i] = direct[i];
+    if (indirect != -1) {
+	synchDisk->ReadSector(indirect, (char *)block);
+	for (n = 0; i < numExtents && n < ExtentsPerBlock; n++)
+	    table[i++] = block[n];
+    }
+    if (doubleIndirect != -1) {
+	blocks = new int[PointersPerBlock];
+	synchDisk->ReadSector(doubleIndirect, (char *)blocks);
+	for (int b = 0; i < numExtents; b++) {
+	    synchDisk->ReadSector(blocks[b], (char *)block);
+	    for (n = 0; i < numExtents && n < ExtentsPerBlock; n++)
+		table[i++] = block[n];
+	}
+    }
+    delete [] block;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	spilling the extents that do not fit in it into its indirect
+//	blocks.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -90,7 +303,29 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
+    Extent *block = new Extent[ExtentsPerBlock];
+    int i, n;
+
+    bzero(unused, sizeof(unused));
+    for (i = 0; i < numExtents && i < NumDirect; i++)
+	direct[i] = table[i];
     synchDisk->WriteSector(sector, (char *)this); 
+    if (indirect != -1) {
+	bzero((char *)block, SectorSize);
+	for (n = 0; i < numExtents && n < ExtentsPerBlock; n++)
+	    block[n] = table[i++];
+	synchDisk->WriteSector(indirect, (char *)block);
+    }
+    if (doubleIndirect != -1) {
+	synchDisk->WriteSector(doubleIndirect, (char *)blocks);
+	for (int b = 0; i < numExtents; b++) {
+	    bzero((char *)block, SectorSize);
+	    for (n = 0; i < numExtents && n < ExtentsPerBlock; n++)
+		block[n] = table[i++];
+	    synchDisk->WriteSector(blocks[b], (char *)block);
+	}
+    }
+    delete [] block;
 }
 
 //----------------------------------------------------------------------
@@ -106,7 +341,32 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    int runLength;
+
+    return ByteToRun(offset, &runLength);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ByteToRun
+// 	Like ByteToSector, but also set "*runLength" to the number of 
+//	sectors, starting with that one, that are consecutive both in 
+//	the file and on disk -- the rest of the extent.
+//----------------------------------------------------------------------
+
+int
+FileHeader::ByteToRun(int offset, int *runLength)
+{
+    int block = offset / SectorSize;
+
+    for (int i = 0; i < numExtents; i++) {
+	if (block < table[i].length) {
+	    *runLength = table[i].length - block;
+	    return table[i].start + block;
+	}
+	block -= table[i].length;
+    }
+    ASSERT(FALSE);			// offset beyond the end of the file
+    return -1;
 }
 
 //----------------------------------------------------------------------
@@ -120,6 +380,19 @@ FileHeader::FileLength()
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::SetLength
+// 	Change the number of bytes in the file.  The bytes past the data
+//	blocks the file has are not on disk yet; whoever grows the file
+//	must Extend it before writing them out.
+//----------------------------------------------------------------------
+
+void
+FileHeader::SetLength(int length)
+{
+    numBytes = length;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Print
 // 	Print the contents of the file header, and the contents of all
@@ -132,12 +405,12 @@ FileHeader::Print()
     int i, j, k;
     char *data = new char[SectorSize];
 
-    printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+    printf("FileHeader contents.  File size: %d.  File extents:\n", numBytes);
+    for (i = 0; i < numExtents; i++)
+	printf("%d-%d ", table[i].start, table[i].start + table[i].length - 1);
     printf("\nFile contents:\n");
-    for (i = k = 0; i < numSectors; i++) {
-	synchDisk->ReadSector(dataSectors[i], data);
+    for (i = k = 0; k < numBytes; i++) {
+	synchDisk->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
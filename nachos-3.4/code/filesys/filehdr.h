@@ -15,33 +15,62 @@
 #define FILEHDR_H
 
 #include "disk.h"
-#include "bitmap.h"
+#include "freemap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+// A run of "length" consecutive disk sectors starting at "start".
+
+class Extent {
+  public:
+    int start;
+    int length;
+};
+
+#define HeaderInts		5	// integer fields of a file header
+#define NumDirect 	((int)((SectorSize - HeaderInts * sizeof(int)) / sizeof(Extent)))
+#define ExtentsPerBlock	((int)(SectorSize / sizeof(Extent)))
+#define PointersPerBlock	((int)(SectorSize / sizeof(int)))
+#define MaxExtents	(NumDirect + ExtentsPerBlock \
+				+ PointersPerBlock * ExtentsPerBlock)
+#define MaxFileSize 	(NumSectors * SectorSize)
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The data is kept in extents -- runs of consecutive sectors -- so a file
+// laid out contiguously needs only one, and reads and writes of it can
+// move many sectors at a time.
+//
+// The first NumDirect extents are in the header itself.  If there are
+// more, the next ExtentsPerBlock are in a single indirect block, and the
+// rest in indirect blocks listed in a double indirect block.  Since an
+// extent can be any length, a file can be as big as the disk, as long 
+// as its free space is not too badly fragmented.
 //
 // The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// When it is on disk, it is stored in a single sector -- the fields up
+// to "unused" are exactly one sector's worth.  In memory, the header also
+// keeps all the extents in one table, and the sectors of the indirect 
+// blocks under the double indirect block.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// The file header is initialized either by allocating blocks for the 
+// file (if it is a new file), or by reading it from disk.
 
 class FileHeader {
   public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
+    FileHeader();
+    ~FileHeader();
+
+    bool Allocate(FreeMap *freeMap, int fileSize, int near);
+						// Initialize a file header, 
 						//  including allocating space 
-						//  on disk for the file data
-    void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
+						//  on disk for the file data,
+						//  close to sector "near"
+    bool Extend(FreeMap *freeMap, int count, int near);
+						// Add "count" data blocks to
+						//  the end of the file
+    void Deallocate(FreeMap *freeMap);		// De-allocate this file's 
 						//  data blocks
+    void Shrink(FreeMap *freeMap);		// De-allocate the data
+						//  blocks past its end
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
     void WriteBack(int sectorNumber); 	// Write modifications to file header
@@ -50,17 +79,41 @@ class FileHeader {
     int ByteToSector(int offset);	// Convert a byte offset into the file
 					// to the disk sector containing
 					// the byte
+    int ByteToRun(int offset, int *runLength);
+					// The same, also returning how many
+					// consecutive sectors of the file
+					// follow on disk from there
 
     int FileLength();			// Return the length of the file 
 					// in bytes
+    void SetLength(int length);		// Change it, e.g., to append
+    int DataSectors() { return numSectors; }
+					// Data blocks allocated, which may
+					// cover more than the length
 
     void Print();			// Print the contents of the file.
 
   private:
+    int NumIndirectBlocks(int n);	// Double indirect's children needed
+					// for "n" extents
+
+    // On disk
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int numExtents;			// Number of extents in the file
+    int indirect;			// Sector of the single indirect
+					// block, or -1
+    int doubleIndirect;			// Sector of the double indirect
+					// block, or -1
+    Extent direct[NumDirect];		// The first extents of the file
+    char unused[SectorSize - HeaderInts * sizeof(int) 
+			- NumDirect * sizeof(Extent)];
+					// Pad the header to a full sector
+
+    // In memory only
+    Extent *table;			// All "numExtents" extents
+    int *blocks;			// Indirect blocks of the double
+					// indirect block
 };
 
 #endif // FILEHDR_H
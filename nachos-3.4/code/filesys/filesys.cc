@@ -10,12 +10,15 @@
 //	   An entry in the file system directory
 //
 // 	The file system consists of several data structures:
-//	   A bitmap of free disk sectors (cf. bitmap.h)
+//	   A bitmap of free disk sectors (cf. freemap.h), read in at boot
+//	     and kept in memory; only its changed parts are written back
 //	   A directory of file names and file headers
+//	   A journal of changes to the other two, and to file headers
+//	     (cf. journal.h)
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them 
+//      The bitmap, the directory and the journal are represented as
+//	normal files.  Their file headers are located in specific sectors
+//	(sectors 0, 1 and 2), so that the file system can find them 
 //	on bootup.
 //
 //	The file system assumes that the bitmap and directory files are
@@ -23,21 +26,20 @@
 //
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	are written back as one journal transaction, so that they reach
+//	the disk all together or not at all.  If the operation fails, and 
+//	we have modified part of the directory, we simply discard the 
+//	changed version, without writing it back to disk; sectors taken
+//	from the in-memory bitmap are given back.
 //
 // 	Our implementation at this point has the following restrictions:
 //
 //	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   files cannot be bigger than the free space on the disk allows
+//	     (and can only grow so fragmented before they run out of extents)
+//	   only metadata is journaled; if Nachos exits while a file is
+//	    being written, the file may be left with some of the new
+//	    data and some of the old
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -46,23 +48,43 @@
 #include "copyright.h"
 
 #include "disk.h"
-#include "bitmap.h"
+#include "freemap.h"
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
 // sectors, so that they can be located on boot-up.
 #define FreeMapSector 		0
 #define DirectorySector 	1
+#define JournalSector		2
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directory; a directory grows
+// as files are added to it.  The journal must be in one piece.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+#define DirectoryFileSize 	SectorSize
+#define JournalFileSize		(JournalSectors * SectorSize)
+
+//----------------------------------------------------------------------
+// OpenJournal
+// 	Set up the journal for the log whose file header is in
+//	JournalSector.
+//----------------------------------------------------------------------
+
+static Journal *
+OpenJournal()
+{
+    FileHeader *hdr = new FileHeader;
+    int start, run;
+
+    hdr->FetchFrom(JournalSector);
+    start = hdr->ByteToRun(0, &run);
+    ASSERT(run >= JournalSectors);		// allocated in one piece
+    delete hdr;
+    return new Journal(start, JournalSectors);
+}
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -80,24 +102,28 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    dirCache = new DirCache();
     if (format) {
-        BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        Directory *directory = new Directory(DirectoryFileSize);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
+	FileHeader *logHdr = new FileHeader;
 
         DEBUG('f', "Formatting the file system.\n");
+        freeMap = new FreeMap(NumSectors);
 
     // First, allocate space for FileHeaders for the directory and bitmap
     // (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	freeMap->Mark(JournalSector);
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
 
-	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize, FreeMapSector));
+	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize, DirectorySector));
+	ASSERT(logHdr->Allocate(freeMap, JournalFileSize, JournalSector));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -107,6 +133,10 @@ FileSystem::FileSystem(bool format)
         DEBUG('f', "Writing headers back to disk.\n");
 	mapHdr->WriteBack(FreeMapSector);    
 	dirHdr->WriteBack(DirectorySector);
+	logHdr->WriteBack(JournalSector);
+	delete logHdr;
+	journal = OpenJournal();
+	journal->Format();
 
     // OK to open the bitmap and directory files now
     // The file system operations assume these two files are left open
@@ -129,16 +159,125 @@ FileSystem::FileSystem(bool format)
 	    freeMap->Print();
 	    directory->Print();
 
-        delete freeMap; 
 	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
 	}
     } else {
-    // if we are not formatting the disk, just open the files representing
+    // if we are not formatting the disk, first finish whatever the
+    // journal says was committed, then just open the files representing
     // the bitmap and directory; these are left open while Nachos is running
+	journal = OpenJournal();
+	journal->Recover();
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        freeMap = new FreeMap(NumSectors);
+        freeMap->FetchFrom(freeMapFile);
+    }
+    journal->SetFreeMap(freeMap);
+
+    // Every Create, Open and Remove reads these two headers; keep them 
+    // in the buffer cache.
+    synchDisk->Pin(FreeMapSector);
+    synchDisk->Pin(DirectorySector);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::OpenDirectory
+// 	Read in the directory whose header is at "sector".  "*file" is 
+//	set to the open directory file, for writing changes back; pass
+//	both to CloseDirectory when done.
+//----------------------------------------------------------------------
+
+Directory *
+FileSystem::OpenDirectory(int sector, OpenFile **file)
+{
+    Directory *directory;
+
+    if (sector == DirectorySector)
+	*file = directoryFile;			// always open
+    else
+	*file = new OpenFile(sector);
+    directory = new Directory((*file)->Length());
+    directory->FetchFrom(*file);
+    return directory;
+}
+
+void
+FileSystem::CloseDirectory(Directory *directory, OpenFile *file)
+{
+    if (file != directoryFile)
+	delete file;
+    else
+	file->Flush();				// in case it grew
+    delete directory;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Return the header sector of "name" in the directory at
+//	"dirSector", and set "*isDir"; or return -1 if there is no such
+//	file.  The lookup cache is tried first; the directory itself is
+//	only read on a miss.
+//----------------------------------------------------------------------
+
+int
+FileSystem::Lookup(int dirSector, char *name, bool *isDir)
+{
+    OpenFile *file;
+    Directory *directory;
+    int sector = dirCache->Lookup(dirSector, name, isDir);
+
+    if (sector != -1)
+	return sector;
+    directory = OpenDirectory(dirSector, &file);
+    sector = directory->Find(name);
+    if (sector != -1) {
+	*isDir = directory->IsDirectory(name);
+	dirCache->Enter(dirSector, name, sector, *isDir);
+    }
+    CloseDirectory(directory, file);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindDirectory
+// 	Follow "path" from the root directory down to the directory that
+//	should hold its last component.  Copy the last component into 
+//	"name", and return the header sector of the directory; or return
+//	-1 if some directory along the way does not exist (or is not a
+//	directory), or a component is too long.
+//
+//	Paths are names separated by '/'; a leading '/' is optional,
+//	since all paths start at the root.
+//----------------------------------------------------------------------
+
+int
+FileSystem::FindDirectory(char *path, char *name)
+{
+    int dirSector = DirectorySector;
+    bool isDir;
+    char *end;
+    int len;
+
+    for (;;) {
+	while (*path == '/')
+	    path++;
+	for (end = path; *end != '\0' && *end != '/'; end++)
+	    ;
+	len = end - path;
+	if (len > FileNameMaxLen)
+	    return -1;
+	strncpy(name, path, len);
+	name[len] = '\0';
+	while (*end == '/')
+	    end++;
+	if (*end == '\0')
+	    return dirSector;			// "name" is the last one
+	dirSector = Lookup(dirSector, name, &isDir);
+	if (dirSector == -1 || !isDir)
+	    return -1;
+	path = end;
     }
 }
 
@@ -149,6 +288,7 @@ FileSystem::FileSystem(bool format)
 //	to give Create the initial size of the file.
 //
 //	The steps to create a file are:
+//	  Find the directory it goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
@@ -159,58 +299,99 @@ FileSystem::FileSystem(bool format)
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		a directory on the path does not exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
+//	 	no free space for file in directory
 //	 	no free space for data blocks for the file 
 //
 // 	Note that this implementation assumes there is no concurrent access
 //	to the file system!
 //
-//	"name" -- name of file to be created
+//	"name" -- path name of file to be created
 //	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Create(char *name, int initialSize)
 {
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    return MakeFile(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Mkdir
+// 	Create an empty directory.  A directory is a file holding a
+//	Directory, so this is Create, plus writing the empty directory 
+//	into the new file.
+//
+//	"name" -- path name of the directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Mkdir(char *name)
+{
+    DEBUG('f', "Making directory %s\n", name);
+    return MakeFile(name, DirectoryFileSize, TRUE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeFile
+// 	The work of Create and Mkdir.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::MakeFile(char *path, int initialSize, bool isDir)
+{
+    char name[FileNameMaxLen + 1];
+    OpenFile *dirFile;
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *hdr;
-    int sector;
+    int dirSector, sector;
     bool success;
 
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
-
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    dirSector = FindDirectory(path, name);
+    if (dirSector == -1)
+	return FALSE;			// no such directory
+    journal->Begin();
+    directory = OpenDirectory(dirSector, &dirFile);
 
     if (directory->Find(name) != -1)
       success = FALSE;			// file is already in directory
     else {	
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find();	// find a sector to hold the file header
+        sector = freeMap->Find(dirSector);
+					// find a sector to hold the file
+					// header, near the directory
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = FALSE;	// no space in directory
-	else {
+        else if (!directory->Add(name, sector, isDir)) {
+            success = FALSE;	// no space in directory, or bad name
+	    freeMap->Clear(sector);
+	} else {
     	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
+	    if (!hdr->Allocate(freeMap, initialSize, sector)) {
             	success = FALSE;	// no space on disk for data
-	    else {	
+		freeMap->Clear(sector);
+	    } else {	
 	    	success = TRUE;
 		// everthing worked, flush all changes back to disk
     	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
+		if (isDir) {
+		    Directory *empty = new Directory(initialSize);
+		    OpenFile *file = new OpenFile(sector);
+		    empty->WriteBack(file);
+		    delete file;
+		    delete empty;
+		}
+    	    	directory->WriteBack(dirFile);
     	    	freeMap->WriteBack(freeMapFile);
+		dirCache->Enter(dirSector, name, sector, isDir);
 	    }
             delete hdr;
 	}
-        delete freeMap;
     }
-    delete directory;
+    CloseDirectory(directory, dirFile);
+    journal->End();
     return success;
 }
 
@@ -218,88 +399,180 @@ FileSystem::Create(char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
+//	  along its path
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
-    OpenFile *openFile = NULL;
-    int sector;
+    char last[FileNameMaxLen + 1];
+    int dirSector, sector = -1;
+    bool isDir;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
+    dirSector = FindDirectory(name, last);
+    if (dirSector != -1)
+	sector = Lookup(dirSector, last, &isDir);
     if (sector >= 0) 		
-	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
-    return openFile;				// return NULL if not found
+	return new OpenFile(sector);	// name was found in directory 
+    return NULL;			// return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, is open, or is a directory that is not empty.
+//	(An open file keeps its header in memory, shared by whoever opens
+//	it next; its sectors must not be given to another file.)
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path name of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name)
 { 
+    char last[FileNameMaxLen + 1];
+    OpenFile *dirFile;
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *fileHdr;
-    int sector;
+    int dirSector, sector;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
+    dirSector = FindDirectory(name, last);
+    if (dirSector == -1)
+	return FALSE;			// no such directory
+    journal->Begin();
+    directory = OpenDirectory(dirSector, &dirFile);
+    sector = directory->Find(last);
     if (sector == -1) {
-       delete directory;
+       CloseDirectory(directory, dirFile);
+       journal->End();
        return FALSE;			 // file not found 
     }
+    if (FileIsOpen(sector)) {
+	CloseDirectory(directory, dirFile);
+	journal->End();
+	return FALSE;			// file in use
+    }
+    if (directory->IsDirectory(last)) {
+	OpenFile *subFile;
+	Directory *sub = OpenDirectory(sector, &subFile);
+	int numEntries = sub->NumEntries();
+	CloseDirectory(sub, subFile);
+	if (numEntries > 0) {
+	    CloseDirectory(directory, dirFile);
+	    journal->End();
+	    return FALSE;		// directory not empty
+	}
+    }
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
-
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
+#ifdef USER_PROGRAM
+    imageCache->Invalidate(sector);		// the sector may be reused
+#endif
 
     fileHdr->Deallocate(freeMap);  		// remove data blocks
-    freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
+    freeMap->Free(sector);			// remove header block
+    directory->Remove(last);
+    dirCache->Remove(dirSector, last);
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
+    directory->WriteBack(dirFile);		// flush to disk
     delete fileHdr;
-    delete directory;
-    delete freeMap;
+    CloseDirectory(directory, dirFile);
+    journal->End();
     return TRUE;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Add "count" data blocks to the end of the file whose header,
+//	"hdr", lives in "sector", and write the changed part of the free
+//	map back to disk.  The caller writes the header back.  Return 
+//	FALSE if the disk does not have the room.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Extend(FileHeader *hdr, int sector, int count)
+{
+    bool success;
+
+    journal->Begin();
+    success = hdr->Extend(freeMap, count, sector);
+    if (success)
+	freeMap->WriteBack(freeMapFile);
+    journal->End();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Shrink
+// 	Give back the data blocks past the end of the file whose header
+//	is "hdr", and write the changed part of the free map back to
+//	disk.  The caller writes the header back.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Shrink(FileHeader *hdr)
+{
+    journal->Begin();
+    hdr->Shrink(freeMap);
+    freeMap->WriteBack(freeMapFile);
+    journal->End();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the file system, directory by directory,
+//	starting from the root.
 //----------------------------------------------------------------------
 
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
+    ListDirectory(DirectorySector, "/");
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ListDirectory
+// 	List the files in the directory at "sector", whose path is 
+//	"path", then each of its subdirectories in turn.
+//----------------------------------------------------------------------
 
-    directory->FetchFrom(directoryFile);
+void
+FileSystem::ListDirectory(int sector, char *path)
+{
+    OpenFile *file;
+    Directory *directory = OpenDirectory(sector, &file);
+    int numEntries = directory->NumEntries();
+    char **names = new char *[numEntries];
+    int *sectors = new int[numEntries];
+    int i, n = 0;
+
+    printf("%s:\n", path);
     directory->List();
-    delete directory;
+    // find the subdirectories; the directory is not kept open while 
+    // listing them, so copy out what we need
+    directory->Subdirectories(names, sectors, &n);
+    CloseDirectory(directory, file);
+    for (i = 0; i < n; i++) {
+	char *subPath = new char[strlen(path) + strlen(names[i]) + 2];
+	sprintf(subPath, "%s%s/", path, names[i]);
+	ListDirectory(sectors[i], subPath);
+	delete [] subPath;
+	delete [] names[i];
+    }
+    delete [] names;
+    delete [] sectors;
 }
 
 //----------------------------------------------------------------------
@@ -317,8 +590,8 @@ FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
+    OpenFile *file;
+    Directory *directory;
 
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -328,14 +601,12 @@ FileSystem::Print()
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
 
-    directory->FetchFrom(directoryFile);
+    directory = OpenDirectory(DirectorySector, &file);	// all of it
     directory->Print();
+    CloseDirectory(directory, file);
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
-    delete directory;
 } 
@@ -20,9 +20,9 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
+//	in the file system.  There is a tree of directories, starting from
+//	a single "root" directory; files are named by their path from the
+//	root, as in UNIX.  
 //	In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
@@ -37,6 +37,10 @@
 
 #include "copyright.h"
 #include "openfile.h"
+#ifndef FILESYS_STUB
+#include "freemap.h"
+#include "directory.h"
+#endif
 
 #ifdef FILESYS_STUB 		// Temporarily implement file system calls as 
 				// calls to UNIX, until the real file system
@@ -65,6 +69,8 @@ class FileSystem {
 };
 
 #else // FILESYS
+class FileHeader;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -76,20 +82,42 @@ class FileSystem {
 
     bool Create(char *name, int initialSize);  	
 					// Create a file (UNIX creat)
+    bool Mkdir(char *name);		// Create a directory (UNIX mkdir)
 
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
 
-    bool Remove(char *name);  		// Delete a file (UNIX unlink)
+    bool Remove(char *name);  		// Delete a file, or an empty
+					// directory (UNIX unlink/rmdir)
 
     void List();			// List all the files in the file system
 
     void Print();			// List all the files and their contents
 
+    bool Extend(FileHeader *hdr, int sector, int count);
+					// Give a file more data blocks
+					// (cf. OpenFile::Flush)
+    void Shrink(FileHeader *hdr);	// Take back those it did not use
+
   private:
    OpenFile* freeMapFile;		// Bit map of free disk blocks,
 					// represented as a file
+   FreeMap* freeMap;			// The same, kept in memory
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   DirCache* dirCache;			// Recent name lookups
+
+   Directory *OpenDirectory(int sector, OpenFile **file);
+   void CloseDirectory(Directory *directory, OpenFile *file);
+					// Read in a directory, and let it go
+   int Lookup(int dirSector, char *name, bool *isDir);
+					// Find "name" in a directory
+   int FindDirectory(char *path, char *name);
+					// Find the directory that holds the
+					// last component of "path"
+   bool MakeFile(char *path, int initialSize, bool isDir);
+					// Create a file or a directory
+   void ListDirectory(int sector, char *path);
+					// List a directory and those below
 };
 
 #endif // FILESYS
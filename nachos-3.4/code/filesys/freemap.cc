@@ -0,0 +1,229 @@
+// freemap.cc
+//	Routines to allocate and free disk sectors, keeping the per-group
+//	free counts and the dirty parts of the map up to date.  See 
+//	freemap.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "freemap.h"
+
+#define WordsPerChunk	(SectorSize / sizeof(unsigned int))
+
+//----------------------------------------------------------------------
+// FreeMap::FreeMap
+// 	Initialize a map of "nitems" free sectors.  Every part of it is
+//	dirty, since none of it has been written yet.
+//----------------------------------------------------------------------
+
+FreeMap::FreeMap(int nitems) : BitMap(nitems)
+{
+    int i;
+
+    numFree = nitems;
+    groupFree = new int[NumGroups];
+    for (i = 0; i < NumGroups; i++)
+	groupFree[i] = SectorsPerGroup;
+    numChunks = divRoundUp(numWords, WordsPerChunk);
+    dirty = new bool[numChunks];
+    for (i = 0; i < numChunks; i++)
+	dirty[i] = TRUE;
+    freed = new unsigned int[numWords];
+    bzero((char *) freed, numWords * sizeof(unsigned int));
+    numFreed = 0;
+}
+
+FreeMap::~FreeMap()
+{
+    delete [] groupFree;
+    delete [] dirty;
+    delete [] freed;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Mark/Clear
+// 	Allocate or free sector "which".
+//----------------------------------------------------------------------
+
+void
+FreeMap::Mark(int which)
+{
+    ASSERT(!Test(which));
+    BitMap::Mark(which);
+    numFree--;
+    groupFree[which / SectorsPerGroup]--;
+    dirty[which / BitsInWord / WordsPerChunk] = TRUE;
+}
+
+void
+FreeMap::Clear(int which)
+{
+    ASSERT(Test(which));
+    BitMap::Clear(which);
+    numFree++;
+    groupFree[which / SectorsPerGroup]++;
+    dirty[which / BitsInWord / WordsPerChunk] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Free
+// 	Free sector "which", which belongs to a file that is being
+//	removed.  On disk, the map shows it free as soon as it is
+//	written back; but in memory it stays allocated until
+//	ReleaseFreed.  Otherwise another operation in the same group
+//	commit could take it and overwrite it, and a crash before the
+//	commit would leave the removed file -- still there after the
+//	replay -- pointing to the other file's data.
+//----------------------------------------------------------------------
+
+void
+FreeMap::Free(int which)
+{
+    unsigned int bit = 1 << (which % BitsInWord);
+
+    ASSERT(Test(which) && !(freed[which / BitsInWord] & bit));
+    freed[which / BitsInWord] |= bit;
+    numFreed++;
+    dirty[which / BitsInWord / WordsPerChunk] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::ReleaseFreed
+// 	The transaction that Free'd sectors has committed; they can be
+//	allocated again.  The map on disk already shows them free, so
+//	nothing becomes dirty.  Called by the journal.
+//----------------------------------------------------------------------
+
+void
+FreeMap::ReleaseFreed()
+{
+    if (numFreed == 0)
+	return;
+    for (int i = 0; i < numWords; i++) {
+	if (freed[i] == 0)
+	    continue;
+	for (int j = 0; j < BitsInWord; j++)
+	    if (freed[i] & (1 << j)) {
+		int which = i * BitsInWord + j;
+		BitMap::Clear(which);
+		numFree++;
+		groupFree[which / SectorsPerGroup]++;
+	    }
+	freed[i] = 0;
+    }
+    DEBUG('f', "Released %d freed sectors\n", numFreed);
+    numFreed = 0;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::GroupToSearch
+// 	Pick the group to start looking for "want" free sectors in: the
+//	group of "near" or the first one after it (wrapping around) with
+//	that many free, or with a whole group's worth if "want" is more
+//	than a group.  If there is none, just start at "near"'s group.
+//----------------------------------------------------------------------
+
+int
+FreeMap::GroupToSearch(int want, int near)
+{
+    int first = (near / SectorsPerGroup) % NumGroups;
+
+    if (want > SectorsPerGroup)
+	want = SectorsPerGroup;
+    for (int i = 0; i < NumGroups; i++) {
+	int g = (first + i) % NumGroups;
+	if (groupFree[g] >= want)
+	    return g;
+    }
+    return first;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Find
+// 	Allocate one free sector close after "near".  Return -1 if the
+//	disk is full.
+//----------------------------------------------------------------------
+
+int
+FreeMap::Find(int near)
+{
+    int start;
+
+    if (numFree == 0)
+	return -1;
+    if (near / SectorsPerGroup != GroupToSearch(1, near))
+	near = GroupToSearch(1, near) * SectorsPerGroup;
+    if (BitMap::FindRun(1, near, &start) == 0)
+	return -1;
+    Mark(start);
+    return start;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::FindRun
+// 	Look for "want" free sectors in a row, starting from "near" if
+//	its group has room, else from the next group that does.  The
+//	sectors are not allocated; the caller Marks the ones it takes.
+//----------------------------------------------------------------------
+
+int
+FreeMap::FindRun(int want, int near, int *start)
+{
+    int group = GroupToSearch(want, near);
+
+    if (group != near / SectorsPerGroup)
+	near = group * SectorsPerGroup;
+    return BitMap::FindRun(want, near, start);
+}
+
+//----------------------------------------------------------------------
+// FreeMap::FetchFrom
+// 	Read the map from its file, and count the free sectors.
+//----------------------------------------------------------------------
+
+void
+FreeMap::FetchFrom(OpenFile *file)
+{
+    int i;
+
+    BitMap::FetchFrom(file);
+    numFree = 0;
+    for (i = 0; i < NumGroups; i++)
+	groupFree[i] = 0;
+    for (i = 0; i < numBits; i++)
+	if (!Test(i)) {
+	    numFree++;
+	    groupFree[i / SectorsPerGroup]++;
+	}
+    for (i = 0; i < numChunks; i++)
+	dirty[i] = FALSE;
+    bzero((char *) freed, numWords * sizeof(unsigned int));
+    numFreed = 0;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::WriteBack
+// 	Write the sectors of the map that have changed since the last
+//	FetchFrom or WriteBack to its file.  Sectors that are Free'd but
+//	not yet released are written as free.
+//----------------------------------------------------------------------
+
+void
+FreeMap::WriteBack(OpenFile *file)
+{
+    unsigned int words[WordsPerChunk];
+
+    for (int i = 0; i < numChunks; i++) {
+	if (!dirty[i])
+	    continue;
+	int first = i * WordsPerChunk;
+	int n = min((int) WordsPerChunk, numWords - first);
+	for (int j = 0; j < n; j++)
+	    words[j] = map[first + j] & ~freed[first + j];
+	file->WriteAt((char *) words, n * sizeof(unsigned int),
+					first * sizeof(unsigned int));
+	dirty[i] = FALSE;
+    }
+}
@@ -0,0 +1,65 @@
+// freemap.h
+//	Data structures for keeping track of free disk sectors.
+//
+//	The free map is a bitmap with one bit per sector, kept in memory
+//	for as long as the file system is running -- it is read from its
+//	file once, at boot, instead of on every Create and Remove.
+//
+//	Besides the bits, it keeps a count of the free sectors in each
+//	"cylinder group" (a run of TracksPerGroup tracks), so that space
+//	can be found near a given sector without scanning the map, and it
+//	remembers which sectors of the free map file have changed, so that
+//	only those are written back.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef FREEMAP_H
+#define FREEMAP_H
+
+#include "bitmap.h"
+#include "disk.h"
+
+#define TracksPerGroup		16
+#define SectorsPerGroup		(TracksPerGroup * SectorsPerTrack)
+#define NumGroups		(NumTracks / TracksPerGroup)
+
+class FreeMap : public BitMap {
+  public:
+    FreeMap(int nitems);		// All sectors free
+    ~FreeMap();
+
+    void Mark(int which);		// Allocate/free a sector, keeping
+    void Clear(int which);		// the counts and dirty marks
+    void Free(int which);		// Free a sector on disk, but keep it
+					// from being reused until the
+					// operation freeing it commits
+    void ReleaseFreed();		// It has; the sectors can be reused
+    int Find(int near);			// Allocate a free sector, as close
+					// after "near" as possible
+    int FindRun(int want, int near, int *start);
+					// Look for "want" free sectors in a
+					// row, preferably close after "near"
+					// (cf. BitMap::FindRun)
+    int NumClear() { return numFree; }
+
+    void FetchFrom(OpenFile *file);	// Read the whole map
+    void WriteBack(OpenFile *file);	// Write the changed parts
+
+  private:
+    int GroupToSearch(int want, int near);
+					// The first group, from the one 
+					// holding "near", with room
+
+    int numFree;			// Free sectors in all
+    int *groupFree;			// Free sectors in each group
+    int numChunks;			// Sectors of the free map file
+    bool *dirty;			// Has each of them changed?
+    unsigned int *freed;		// Sectors freed by Free, not yet
+    int numFreed;			// released
+};
+
+#endif // FREEMAP_H
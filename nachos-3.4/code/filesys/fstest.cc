@@ -5,8 +5,8 @@
 //	   Copy -- copy a file from UNIX to Nachos
 //	   Print -- cat the contents of a Nachos file 
 //	   Perftest -- a stress test for the Nachos file system
-//		read and write a really large file in tiny chunks
-//		(won't work on baseline system!)
+//		read and write a really large file in tiny chunks, growing
+//		the file as it is written
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -183,3 +183,83 @@ PerformanceTest()
     stats->Print();
 }
 
+
+//----------------------------------------------------------------------
+// DiskSchedTest
+// 	Measure how long disk requests wait under each scheduling
+//	policy.  Several reader threads go straight to the disk (not
+//	through the cache), each with one request outstanding at a
+//	time: half of them read runs of consecutive sectors, from
+//	different parts of the disk, the other half read at random.
+//	For each policy, print the mean, 99th percentile and worst
+//	latency, in ticks.
+//
+//	Implemented as:
+//	  DiskReader -- body of each reader thread
+//	  DiskSchedTest -- fork the readers, collect and print the results
+//----------------------------------------------------------------------
+
+#define NumDiskReaders		6
+#define ReadsPerReader		50
+#define NumDiskReads		(NumDiskReaders * ReadsPerReader)
+
+static int diskLatency[NumDiskReads];	// latency of every read
+static int numDiskReads;		// entries of diskLatency in use
+static Semaphore *readersDone;		// V'ed as each reader finishes
+
+static void
+DiskReader(int which)
+{
+    char data[SectorSize];
+    int sector = (which * NumSectors) / NumDiskReaders;
+
+    for (int i = 0; i < ReadsPerReader; i++) {
+	if (which % 2 == 0)			// sequential reader
+	    sector = (sector + 1) % NumSectors;
+	else					// random reader
+	    sector = Random() % NumSectors;
+	diskLatency[numDiskReads++] = 
+		synchDisk->Wait(synchDisk->Submit(sector, data, FALSE));
+    }
+    readersDone->V();
+}
+
+void
+DiskSchedTest()
+{
+    static char *names[] = { "fcfs", "sstf", "clook", "deadline" };
+    DiskSchedPolicy saved = diskSchedPolicy;
+    int policy, i, j;
+
+    printf("Starting disk scheduling test: %d readers, %d reads each\n",
+	   NumDiskReaders, ReadsPerReader);
+    readersDone = new Semaphore("disk readers", 0);
+    for (policy = FCFS; policy <= DeadlineSched; policy++) {
+	int start = stats->totalTicks;
+	double total = 0;
+
+	diskSchedPolicy = (DiskSchedPolicy) policy;
+	numDiskReads = 0;
+	for (i = 0; i < NumDiskReaders; i++) {
+	    Thread *t = new Thread("disk reader");
+	    t->Fork(DiskReader, i);
+	}
+	for (i = 0; i < NumDiskReaders; i++)
+	    readersDone->P();
+
+	for (i = 1; i < numDiskReads; i++) {	// sort, for the percentile
+	    int latency = diskLatency[i];
+	    for (j = i; j > 0 && diskLatency[j - 1] > latency; j--)
+		diskLatency[j] = diskLatency[j - 1];
+	    diskLatency[j] = latency;
+	}
+	for (i = 0; i < numDiskReads; i++)
+	    total += diskLatency[i];
+	printf("%-8s: mean %d, p99 %d, max %d ticks; %d ticks in all\n",
+	       names[policy], (int) (total / numDiskReads),
+	       diskLatency[(numDiskReads * 99) / 100],
+	       diskLatency[numDiskReads - 1], stats->totalTicks - start);
+    }
+    delete readersDone;
+    diskSchedPolicy = saved;
+}
@@ -0,0 +1,403 @@
+// journal.cc
+//	Routines to keep the write-ahead log of file system metadata.
+//	See journal.h for the overall scheme.
+//
+//	SynchDisk does the holding: a sector written while the current
+//	thread is inside an operation is kept pinned in the cache, and
+//	skipped by write-backs, until Commit lets it go.  The journal
+//	just remembers which sectors those are.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "journal.h"
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the journal for the log in sectors "firstSector"
+//	through "firstSector" + "numSectors" - 1.  Format or Recover must be called
+//	before it is used.
+//----------------------------------------------------------------------
+
+Journal::Journal(int firstSector, int numSectors)
+{
+    start = firstSector;
+    size = numSectors;
+    next = 1;
+    seq = 0;
+    held = new int[MaxHeldSectors];
+    images = new char[MaxHeldSectors * SectorSize];
+    imaged = new bool[MaxHeldSectors];
+    numHeld = numOps = 0;
+    freeMap = NULL;
+    lock = new Lock("journal");
+    depth = 0;
+    suspended = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	Commit the running transaction, so that nothing is left held in
+//	the cache, and de-allocate the journal.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    Commit();
+    delete lock;
+    delete [] held;
+    delete [] images;
+    delete [] imaged;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin/End
+// 	Bracket an operation that changes metadata.  Operations run one
+//	at a time; an operation may call others (Create growing the
+//	directory file, for instance), which are then part of it.
+//
+//	Begin first commits the running transaction if it has grown big,
+//	so that an operation always has room.  End commits it if it has
+//	GroupCommitOps operations; otherwise it waits for the next one.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    if (lock->isHeldByCurrentThread()) {
+	depth++;
+	return;
+    }
+    lock->Acquire();
+    depth = 1;
+    if (numHeld >= GroupCommitSectors)
+	CommitRunning();
+}
+
+void
+Journal::End()
+{
+    ASSERT(lock->isHeldByCurrentThread() && depth > 0);
+    if (--depth > 0)
+	return;
+    if (++numOps >= GroupCommitOps)
+	CommitRunning();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Logging
+// 	Return TRUE if sectors written now belong to the running
+//	transaction.
+//----------------------------------------------------------------------
+
+bool
+Journal::Logging()
+{
+    return depth > 0 && !suspended && lock->isHeldByCurrentThread();
+}
+
+//----------------------------------------------------------------------
+// Journal::Suspend/Resume
+// 	Bracket writes, inside an operation, of file data rather than
+//	metadata -- typically into blocks the operation has just
+//	allocated.  They are not held or logged; instead SynchDisk
+//	writes them to their home location at once, so they are on disk
+//	before the operation's commit record is (ordered mode).  Until
+//	then no committed header points to those blocks, so a crash
+//	leaves nothing inconsistent, and once the header is committed,
+//	a replay cannot find them holding stale data.
+//----------------------------------------------------------------------
+
+void
+Journal::Suspend()
+{
+    ASSERT(lock->isHeldByCurrentThread() && depth > 0 && !suspended);
+    suspended = TRUE;
+}
+
+void
+Journal::Resume()
+{
+    ASSERT(lock->isHeldByCurrentThread() && suspended);
+    suspended = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Ordered
+// 	Return TRUE if sectors written now are file data, to be written
+//	through to the disk before the running transaction commits.
+//----------------------------------------------------------------------
+
+bool
+Journal::Ordered()
+{
+    return depth > 0 && suspended && lock->isHeldByCurrentThread();
+}
+
+//----------------------------------------------------------------------
+// Journal::MakeRoom
+// 	The operation in progress is about to write "count" more
+//	sectors.  If the running transaction could not hold them, commit
+//	what it has so far.  The operation then is no longer all or
+//	nothing: a crash can leave its first part done and the rest not.
+//	That only happens for operations bigger than any the file system
+//	makes on its own -- rewriting a huge directory, say -- and it is
+//	better than running out of cache.
+//----------------------------------------------------------------------
+
+void
+Journal::MakeRoom(int count)
+{
+    ASSERT(lock->isHeldByCurrentThread() && depth > 0);
+    if (numHeld + count <= MaxHeldSectors)
+	return;
+    DEBUG('f', "Operation too big for one transaction; committing %d "
+	  "sectors early\n", numHeld);
+    CommitRunning();
+}
+
+//----------------------------------------------------------------------
+// Journal::Add
+// 	SynchDisk has just started holding "sector" for the running
+//	transaction.  If the buffer was dirty, "committed" is what it
+//	held until now: changes committed by an earlier transaction that
+//	have not reached their home location yet.  Keep a copy, for
+//	Checkpoint.  Called with the cache locked, so this must not
+//	block.
+//----------------------------------------------------------------------
+
+void
+Journal::Add(int sector, char *committed)
+{
+    ASSERT(numHeld < MaxHeldSectors);	// MakeRoom was called
+    imaged[numHeld] = (committed != NULL);
+    if (committed != NULL)
+	bcopy(committed, &images[numHeld * SectorSize], SectorSize);
+    held[numHeld++] = sector;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Commit the running transaction now; called by the flusher, so
+//	that changes do not stay in memory indefinitely, and at shutdown.
+//	Waits for the operation in progress, if any, to finish.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    lock->Acquire();
+    CommitRunning();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::CommitRunning
+// 	Write the running transaction to the log -- descriptors, copies
+//	of the held sectors, and the commit record -- as one disk request
+//	to consecutive sectors.  Once it is done, the transaction is
+//	safe, so let its sectors go: the cache writes them home in its
+//	own time.  The sectors it freed can be reused now, too.
+//----------------------------------------------------------------------
+
+void
+Journal::CommitRunning()
+{
+    int numDesc, n, i;
+    char *buf, **vector;
+    LogRecord *rec;
+
+    if (numHeld == 0) {
+	numOps = 0;
+	if (freeMap != NULL)
+	    freeMap->ReleaseFreed();
+	return;
+    }
+    numDesc = divRoundUp(numHeld, DescEntries);
+    n = numDesc + numHeld + 1;
+    ASSERT(n < size);
+    if (next + n > size)
+	Checkpoint();
+
+    buf = new char[n * SectorSize];
+    vector = new char *[n];
+    bzero(buf, n * SectorSize);
+    for (i = 0; i < n; i++)
+	vector[i] = &buf[i * SectorSize];
+    for (i = 0; i < numDesc; i++) {		// descriptors
+	rec = (LogRecord *) vector[i];
+	rec->magic = JournalMagic;
+	rec->type = DescRecord;
+	rec->seq = seq;
+	rec->count = numHeld;
+    }
+    for (i = 0; i < numHeld; i++) {
+	int *entries = (int *) (vector[i / DescEntries] + sizeof(LogRecord));
+	entries[i % DescEntries] = held[i];
+	synchDisk->ReadSector(held[i], vector[numDesc + i]);	// a hit
+    }
+    rec = (LogRecord *) vector[n - 1];		// commit
+    rec->magic = JournalMagic;
+    rec->type = CommitRecord;
+    rec->seq = seq;
+    rec->count = numHeld;
+
+    synchDisk->Wait(synchDisk->SubmitVector(start + next, n, vector, TRUE));
+    DEBUG('f', "Committed transaction %d: %d operations, %d sectors\n",
+	  seq, numOps, numHeld);
+    next += n;
+    seq++;
+    for (i = 0; i < numHeld; i++)
+	synchDisk->Release(held[i]);
+    if (freeMap != NULL)
+	freeMap->ReleaseFreed();
+    numHeld = numOps = 0;
+    delete [] vector;
+    delete [] buf;
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Write every committed change home, so that the log is no longer
+//	needed, and start it over.  The sectors of the running
+//	transaction are still held, and the flush skips them; those
+//	that had committed changes of their own when the transaction
+//	took them go home directly, from the copies Add kept.
+//
+//	The superblock is only rewritten once all of that is on disk:
+//	sectors that the flush found already being written out are
+//	waited for, and flushed again if they are still dirty.
+//----------------------------------------------------------------------
+
+void
+Journal::Checkpoint()
+{
+    DiskRequest **requests = new DiskRequest *[numHeld];
+    int i, numRequests = 0;
+
+    DEBUG('f', "Checkpointing the journal\n");
+    synchDisk->Flush();
+    synchDisk->WaitForWrites();
+    synchDisk->Flush();
+    for (i = 0; i < numHeld; i++)
+	if (imaged[i])
+	    requests[numRequests++] = synchDisk->Submit(held[i],
+					&images[i * SectorSize], TRUE);
+    for (i = 0; i < numRequests; i++)
+	synchDisk->Wait(requests[i]);
+    delete [] requests;
+    next = 1;
+    WriteSuper();
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteSuper
+// 	Record in the superblock that the log starts over at sector 1,
+//	with transaction "seq".  Transactions with other numbers left
+//	further on in the log are ignored from now on.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteSuper()
+{
+    char buf[SectorSize];
+    LogRecord *rec = (LogRecord *) buf;
+
+    bzero(buf, SectorSize);
+    rec->magic = JournalMagic;
+    rec->type = SuperRecord;
+    rec->seq = seq;
+    rec->count = 0;
+    synchDisk->Wait(synchDisk->Submit(start, buf, TRUE));
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Write an empty log, for a newly formatted disk.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    seq = 0;
+    next = 1;
+    WriteSuper();
+}
+
+//----------------------------------------------------------------------
+// Journal::ReadRecord
+// 	Read sector "sector" of the log into "buf", and return TRUE if
+//	it is a "type" record of transaction "seq".
+//----------------------------------------------------------------------
+
+bool
+Journal::ReadRecord(int sector, LogRecordType type, char *buf)
+{
+    LogRecord *rec = (LogRecord *) buf;
+
+    if (sector >= size)
+	return FALSE;
+    synchDisk->Wait(synchDisk->Submit(start + sector, buf, FALSE));
+    return rec->magic == JournalMagic && rec->type == type && rec->seq == seq;
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Replay the log, at mount.  Starting from the superblock, copy the
+//	sectors of each transaction that has its commit record to their
+//	home location; stop at the first one that does not (it was being
+//	written when Nachos stopped, and none of its sectors went home).
+//	Then write everything out, and start with an empty log.
+//----------------------------------------------------------------------
+
+void
+Journal::Recover()
+{
+    char buf[SectorSize];
+    char *desc, *data;
+    LogRecord *rec = (LogRecord *) buf;
+    int count, numDesc, numReplayed = 0, i;
+
+    synchDisk->Wait(synchDisk->Submit(start, buf, FALSE));
+    if (rec->magic != JournalMagic || rec->type != SuperRecord) {
+	DEBUG('f', "No journal found; starting a new one\n");
+	Format();
+	return;
+    }
+    seq = rec->seq;
+    for (next = 1; ReadRecord(next, DescRecord, buf); ) {
+	count = rec->count;
+	numDesc = divRoundUp(count, DescEntries);
+	if (!ReadRecord(next + numDesc + count, CommitRecord, buf))
+	    break;				// never committed
+
+	desc = new char[numDesc * SectorSize];
+	data = new char[SectorSize];
+	for (i = 0; i < numDesc; i++)
+	    synchDisk->Wait(synchDisk->Submit(start + next + i,
+					&desc[i * SectorSize], FALSE));
+	for (i = 0; i < count; i++) {
+	    int *entries = (int *) (&desc[(i / DescEntries) * SectorSize]
+					+ sizeof(LogRecord));
+	    synchDisk->Wait(synchDisk->Submit(start + next + numDesc + i,
+					data, FALSE));
+	    synchDisk->WriteSector(entries[i % DescEntries], data);
+	}
+	delete [] data;
+	delete [] desc;
+	next += numDesc + count + 1;
+	seq++;
+	numReplayed++;
+    }
+    DEBUG('f', "Replayed %d transactions from the journal\n", numReplayed);
+    if (numReplayed > 0)
+	Checkpoint();
+    else {
+	next = 1;
+	WriteSuper();
+    }
+}
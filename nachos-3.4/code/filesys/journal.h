@@ -0,0 +1,119 @@
+// journal.h
+//	Data structures for the write-ahead log of file system metadata.
+//
+//	An operation that changes metadata -- file headers, directories,
+//	the free map -- is bracketed by Begin and End.  The sectors it
+//	writes stay in the buffer cache, held there: they are not written
+//	to their home location until the transaction that changed them
+//	has been committed to the log.
+//
+//	Transactions are committed in groups: the changes of up to
+//	GroupCommitOps operations are written to the log together, in one
+//	sequential disk request.  Then the sectors are let go, and reach
+//	their home location whenever the cache writes them back.  Only
+//	when the log fills up do we have to wait for that (a checkpoint).
+//
+//	After a crash, mounting the file system replays the committed
+//	transactions in the log, so an operation is either all on disk,
+//	or not at all.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synch.h"
+#include "freemap.h"
+
+#define JournalSectors		128	// size of the log on disk
+#define GroupCommitOps		8	// operations per commit, at most
+#define GroupCommitSectors	16	// commit before a new operation if
+					// this many sectors are held
+#define MaxHeldSectors		40	// most sectors a transaction may
+					// hold in the cache; an operation
+					// that needs more is committed
+					// part-way
+
+// On disk, the log starts with a superblock, and then has transactions
+// one after another.  A transaction is one or more descriptor sectors
+// listing where the sectors it changed belong, copies of the sectors,
+// and a commit sector.  Each of these sectors starts with a LogRecord.
+
+#define JournalMagic		0x4a524e4c
+#define DescEntries		((SectorSize - sizeof(LogRecord)) / sizeof(int))
+
+enum LogRecordType { SuperRecord, DescRecord, CommitRecord };
+
+class LogRecord {
+  public:
+    int magic;				// JournalMagic
+    int type;				// a LogRecordType
+    int seq;				// number of the transaction
+    int count;				// sectors changed by it
+};
+
+// The following class defines the journal.  It owns the "firstSector"
+// sector on disk and the numSectors - 1 after it.
+
+class Journal {
+  public:
+    Journal(int firstSector, int numSectors);
+    ~Journal();				// Commit what is left
+
+    void SetFreeMap(FreeMap *map) { freeMap = map; }
+					// Sectors Free'd in "map" are
+					// released at each commit
+
+    void Format();			// Write an empty log
+    void Recover();			// Replay the committed transactions
+
+    void Begin();			// Start a metadata operation; they
+					// can be nested
+    void End();				// Finish one
+    bool Logging();			// Is the current thread inside an
+					// operation, and not suspended?
+    void Suspend();			// Within an operation, write file
+    void Resume();			// data straight to disk, unlogged
+    bool Ordered();			// Is the current thread between
+					// Suspend and Resume?
+    void MakeRoom(int count);		// Before "count" more sectors are
+					// held, commit part-way if they
+					// would not fit
+    void Add(int sector, char *committed);
+					// Note that a held sector is part
+					// of the running transaction;
+					// called by SynchDisk
+    void Commit();			// Write the running transaction to
+					// the log
+
+  private:
+    void CommitRunning();		// Commit, with "lock" held
+    void Checkpoint();			// Make the log empty again
+    void WriteSuper();			// Write the superblock
+    bool ReadRecord(int sector, LogRecordType type, char *buf);
+					// Read a sector of the log, and
+					// check it is the record we expect
+
+    int start;				// First sector of the log
+    int size;				// Sectors in the log
+    int next;				// Where the next transaction goes
+    int seq;				// Number of the next transaction
+
+    int *held;				// Sectors of the running transaction
+    int numHeld;
+    char *images;			// What each held when it was still
+    bool *imaged;			// committed but not yet home
+    int numOps;				// Operations in it
+    FreeMap *freeMap;			// Where they free sectors
+
+    Lock *lock;				// One operation at a time
+    int depth;				// Nesting of Begin's by the owner
+    bool suspended;			// Between Suspend and Resume?
+};
+
+#endif // JOURNAL_H
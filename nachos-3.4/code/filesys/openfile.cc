@@ -5,7 +5,16 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open: one copy, however many times the
+//	file is open (cf. OpenHeader).
+//
+//	Files grow when written past the end.  Disk space for the new
+//	data is allocated late: the data is held in memory until there
+//	are AllocChunk sectors of it, or the file is flushed or closed,
+//	and then a whole chunk is allocated at once, normally right after
+//	the file's last data block.  So a file written by appending stays
+//	contiguous on disk, and the free map and file header are written
+//	once per chunk rather than once per sector.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -19,29 +28,112 @@
 #include <strings.h>
 #endif
 
+static OpenHeader *openHeaders = NULL;	// the files that are open
+
+//----------------------------------------------------------------------
+// GetHeader
+// 	Return the in-memory header of the file whose header is at
+//	"sector", reading it in if the file is not open yet, and take a
+//	reference to it.
+//----------------------------------------------------------------------
+
+static OpenHeader *
+GetHeader(int sector)
+{
+    OpenHeader *h;
+    FileHeader *hdr;
+
+    for (h = openHeaders; h != NULL; h = h->next)
+	if (h->sector == sector) {
+	    h->refCount++;
+	    return h;
+	}
+    hdr = new FileHeader;
+    hdr->FetchFrom(sector);
+    for (h = openHeaders; h != NULL; h = h->next)
+	if (h->sector == sector) {	// opened while we were reading
+	    delete hdr;
+	    h->refCount++;
+	    return h;
+	}
+    h = new OpenHeader;
+    h->sector = sector;
+    h->hdr = hdr;
+    h->dirty = FALSE;
+    h->pending = NULL;
+    h->pendingSize = 0;
+    h->refCount = 1;
+    h->next = openHeaders;
+    openHeaders = h;
+    return h;
+}
+
+//----------------------------------------------------------------------
+// PutHeader
+// 	Drop a reference to an in-memory header; when the file is no
+//	longer open at all, de-allocate it.  The caller has flushed it.
+//----------------------------------------------------------------------
+
+static void
+PutHeader(OpenHeader *h)
+{
+    OpenHeader **p;
+
+    if (--h->refCount > 0)
+	return;
+    for (p = &openHeaders; *p != h; p = &(*p)->next)
+	ASSERT(*p != NULL);
+    *p = h->next;
+    delete [] h->pending;
+    delete h->hdr;
+    delete h;
+}
+
+//----------------------------------------------------------------------
+// FileIsOpen
+// 	Return TRUE if some OpenFile is open on the file whose header is
+//	at "sector".
+//----------------------------------------------------------------------
+
+bool
+FileIsOpen(int sector)
+{
+    for (OpenHeader *h = openHeaders; h != NULL; h = h->next)
+	if (h->sector == sector)
+	    return TRUE;
+    return FALSE;
+}
+
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is open already.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    shared = GetHeader(sector);
+    hdr = shared->hdr;
+    hdrSector = sector;
     seekPosition = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	Data written past the end of the file goes to disk first.  If
+//	this is the last OpenFile for the file, the unused part of its
+//	last chunk is given back.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    Flush();
+    if (shared->refCount == 1)
+	GiveBack();
+    PutHeader(shared);
 }
 
 //----------------------------------------------------------------------
@@ -93,18 +185,15 @@ OpenFile::Write(char *into, int numBytes)
 //	Return the number of bytes actually written or read, but has
 //	no side effects (except that Write modifies the file, of course).
 //
-//	There is no guarantee the request starts or ends on an even disk sector
-//	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
+//	A read stops at the end of the file.  A write may start anywhere
+//	up to the end of the file, and makes the file longer if it goes
+//	past the end.  The bytes that fall in the file's data blocks are
+//	transferred to or from disk now (cf. ReadDisk/WriteDisk); those
+//	past its last data block are only held in memory (cf. HoldBack),
+//	until Flush gives the file more blocks.
 //
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	A write also drops the file from the image cache: if it is a
+//	program, the next Exec must not run the old code.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -117,29 +206,24 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int allocated = hdr->DataSectors() * SectorSize;
+    int onDisk;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if ((numBytes <= 0) || (position < 0) || (position >= fileLength))
     	return 0; 				// check request
     if ((position + numBytes) > fileLength)		
 	numBytes = fileLength - position;
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n", 	
 			numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    onDisk = max(min(position + numBytes, allocated) - position, 0);
+    if (onDisk > 0)
+	ReadDisk(into, onDisk, position);
+    if (onDisk < numBytes) {			// the rest is not on disk yet
+	int start = position + onDisk;
+	bcopy(&shared->pending[start - allocated], into + onDisk,
+						numBytes - onDisk);
+    }
     return numBytes;
 }
 
@@ -147,42 +231,252 @@ int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int allocated = hdr->DataSectors() * SectorSize;
+    int onDisk;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if ((numBytes <= 0) || (position < 0) || (position > fileLength))
 	return 0;				// check request
-    if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;
-    DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
+    if ((position + numBytes) > MaxFileSize)
+	numBytes = MaxFileSize - position;
+    DEBUG('f', "Writing %d bytes at %d, to file of length %d.\n", 	
 			numBytes, position, fileLength);
+#ifdef USER_PROGRAM
+    imageCache->Invalidate(hdrSector);
+#endif
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
+    if ((position + numBytes) > fileLength) {
+	hdr->SetLength(position + numBytes);	// the file grows
+	shared->dirty = TRUE;
+    }
+    onDisk = max(min(position + numBytes, allocated) - position, 0);
+    if (onDisk > 0)
+	WriteDisk(from, onDisk, position);
+    if (onDisk < numBytes) {
+	HoldBack(from + onDisk, numBytes - onDisk, position + onDisk);
+	if (hdr->FileLength() - allocated >= AllocChunk * SectorSize)
+	    Flush();				// enough for a whole chunk
+    }
+    return numBytes;
+}
 
-    buf = new char[numSectors * SectorSize];
+//----------------------------------------------------------------------
+// OpenFile::ReadDisk/WriteDisk
+// 	Transfer bytes between "into"/"from" and the file's data blocks;
+//	all of them must lie within the blocks the file has.
+//
+//	There is no guarantee the request starts or ends on an even disk sector
+//	boundary; however the disk only knows how to read/write a whole disk
+//	sector at a time.  So the request is split in three: a partial
+//	sector at the start, the whole sectors in the middle, and a
+//	partial sector at the end; either partial one may be missing.
+//
+//	The whole sectors are moved straight between the caller's buffer
+//	and the disk (cf. Transfer), with no copy in between.  Only the
+//	partial sectors go through a one-sector buffer:
+//
+//	For ReadDisk:
+//	   We read in the sector, and copy out the part we are interested in.
+//	For WriteDisk:
+//	   We must first read in the sector, so that we don't overwrite the
+//	   unmodified portion, then copy in the data that will be modified,
+//	   and write the sector back.
+//----------------------------------------------------------------------
 
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
+void
+OpenFile::ReadDisk(char *into, int numBytes, int position)
+{
+    char buf[SectorSize];
+    int offset = position % SectorSize;
+    int sector = position / SectorSize;
+    int n;
 
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+    ASSERT(divRoundUp(position + numBytes, SectorSize) <= hdr->DataSectors());
+    if (offset != 0 || numBytes < SectorSize) {	// partial first sector
+	n = min(numBytes, SectorSize - offset);
+	synchDisk->ReadSector(hdr->ByteToSector(position), buf);
+	bcopy(&buf[offset], into, n);
+	into += n;
+	numBytes -= n;
+	sector++;
+    }
+    n = numBytes / SectorSize;
+    if (n > 0) {				// whole sectors
+	Transfer(sector, n, into, FALSE);
+	into += n * SectorSize;
+	numBytes -= n * SectorSize;
+	sector += n;
+    }
+    if (numBytes > 0) {				// partial last sector
+	synchDisk->ReadSector(hdr->ByteToSector(sector * SectorSize), buf);
+	bcopy(buf, into, numBytes);
+    }
+}
+
+void
+OpenFile::WriteDisk(char *from, int numBytes, int position)
+{
+    char buf[SectorSize];
+    int offset = position % SectorSize;
+    int sector = position / SectorSize;
+    int n, diskSector;
 
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+    ASSERT(divRoundUp(position + numBytes, SectorSize) <= hdr->DataSectors());
+    if (offset != 0 || numBytes < SectorSize) {	// partial first sector
+	n = min(numBytes, SectorSize - offset);
+	diskSector = hdr->ByteToSector(position);
+	synchDisk->ReadSector(diskSector, buf);
+	bcopy(from, &buf[offset], n);
+	synchDisk->WriteSector(diskSector, buf);
+	from += n;
+	numBytes -= n;
+	sector++;
+    }
+    n = numBytes / SectorSize;
+    if (n > 0) {				// whole sectors
+	Transfer(sector, n, from, TRUE);
+	from += n * SectorSize;
+	numBytes -= n * SectorSize;
+	sector += n;
+    }
+    if (numBytes > 0) {				// partial last sector
+	diskSector = hdr->ByteToSector(sector * SectorSize);
+	synchDisk->ReadSector(diskSector, buf);
+	bcopy(from, buf, numBytes);
+	synchDisk->WriteSector(diskSector, buf);
+    }
+}
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
-    return numBytes;
+//----------------------------------------------------------------------
+// OpenFile::Transfer
+// 	Read or write "numSectors" whole sectors of the file, starting
+//	with sector "first" of the file, directly to or from "data", a
+//	run of consecutive disk sectors at a time.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Transfer(int first, int numSectors, char *data, bool writing)
+{
+    int i, sector, run;
+
+    for (i = 0; i < numSectors; i += run) {
+	sector = hdr->ByteToRun((first + i) * SectorSize, &run);
+	if (run > numSectors - i)
+	    run = numSectors - i;
+	if (writing)
+	    synchDisk->WriteSectors(sector, run, &data[i * SectorSize]);
+	else
+	    synchDisk->ReadSectors(sector, run, &data[i * SectorSize]);
+    }
+}
+
+//----------------------------------------------------------------------
+// OpenFile::HoldBack
+// 	Copy bytes that lie past the file's last data block into the
+//	"pending" buffer, growing it as needed.  The buffer starts at the
+//	first byte after the last data block, and is kept zeroed past the
+//	data, so that Flush can write it out in whole sectors.
+//----------------------------------------------------------------------
+
+void
+OpenFile::HoldBack(char *from, int numBytes, int position)
+{
+    int offset = position - hdr->DataSectors() * SectorSize;
+    int size;
+
+    ASSERT(offset >= 0);
+    if (offset + numBytes > shared->pendingSize) {
+	size = max(shared->pendingSize * 2, AllocChunk * SectorSize);
+	while (size < offset + numBytes)
+	    size *= 2;
+	char *buf = new char[size];
+	bzero(buf, size);
+	if (shared->pending != NULL)
+	    bcopy(shared->pending, buf, shared->pendingSize);
+	delete [] shared->pending;
+	shared->pending = buf;
+	shared->pendingSize = size;
+    }
+    bcopy(from, &shared->pending[offset], numBytes);
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Flush
+// 	Give the file enough data blocks for the data held back in
+//	memory -- rounded up to a whole number of AllocChunk's, if the
+//	disk has the room, so that the next appends land in blocks that
+//	are already allocated -- and write the data into them.  Then
+//	write the file header back, if it has changed.
+//
+//	All of this is one journal operation, so that blocks taken from
+//	the free map never reach the disk without the header that points
+//	to them.  The data itself is not logged, but written straight
+//	to disk, ahead of the commit (cf. Journal::Suspend).
+//
+//	If the disk is full, the data past the old last data block is
+//	lost, and the file is cut back to end there.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Flush()
+{
+    int allocated = hdr->DataSectors() * SectorSize;
+    int count = divRoundUp(hdr->FileLength() - allocated, SectorSize);
+
+    if (count <= 0 && !shared->dirty)
+	return;
+    if (journal != NULL)
+	journal->Begin();
+
+    // Another OpenFile for the file may have flushed it while we waited.
+    allocated = hdr->DataSectors() * SectorSize;
+    count = divRoundUp(hdr->FileLength() - allocated, SectorSize);
+    if (count > 0) {
+	if (fileSystem->Extend(hdr, hdrSector, 
+				divRoundUp(count, AllocChunk) * AllocChunk)
+		|| fileSystem->Extend(hdr, hdrSector, count)) {
+	    if (journal != NULL)
+		journal->Suspend();
+	    WriteDisk(shared->pending, count * SectorSize, allocated);
+	    if (journal != NULL)
+		journal->Resume();
+	} else {
+	    DEBUG('f', "No room to grow file %d; %d bytes lost.\n", 
+		  hdrSector, hdr->FileLength() - allocated);
+	    hdr->SetLength(allocated);
+	}
+	delete [] shared->pending;
+	shared->pending = NULL;
+	shared->pendingSize = 0;
+	shared->dirty = TRUE;
+    }
+    if (shared->dirty) {
+	hdr->WriteBack(hdrSector);
+	shared->dirty = FALSE;
+    }
+    if (journal != NULL)
+	journal->End();
+}
+
+//----------------------------------------------------------------------
+// OpenFile::GiveBack
+// 	The file is being closed for the last time.  Flush gives a
+//	growing file whole AllocChunk's; return the blocks of the last
+//	one that the file did not grow into, so that a small file does
+//	not keep a chunk's worth of disk.  Done as one journal operation,
+//	like Flush.
+//----------------------------------------------------------------------
+
+void
+OpenFile::GiveBack()
+{
+    if (hdr->DataSectors() <= divRoundUp(hdr->FileLength(), SectorSize))
+	return;
+    if (journal != NULL)
+	journal->Begin();
+    fileSystem->Shrink(hdr);
+    hdr->WriteBack(hdrSector);
+    if (journal != NULL)
+	journal->End();
 }
 
 //----------------------------------------------------------------------
@@ -52,6 +52,10 @@ class OpenFile {
 		}
 
     int Length() { Lseek(file, 0, 2); return Tell(file); }
+    int HeaderSector() { return FileIdentity(file); }
+					// Same file <=> same value
+    int Version() { return FileVersion(file); }
+					// Changes when the file is written
     
   private:
     int file;
@@ -61,6 +65,27 @@ class OpenFile {
 #else // FILESYS
 class FileHeader;
 
+#define AllocChunk	16	// sectors given to a growing file at once
+
+// The following class holds what is kept in memory about a file while
+// it is open: its header, and the data written past its last data 
+// block.  Every OpenFile for the file shares it, so that they all see
+// the same length and data blocks, and none of them writes back a
+// header that another has since changed.
+
+class OpenHeader {
+  public:
+    int sector;				// Where "hdr" lives on disk
+    FileHeader *hdr;			// Header for the file
+    bool dirty;				// Has "hdr" changed since it was
+					// last written back?
+    char *pending;			// Data past the file's last data
+					// block, not yet on disk
+    int pendingSize;			// Bytes "pending" can hold
+    int refCount;			// OpenFiles sharing it
+    OpenHeader *next;			// Another open file
+};
+
 class OpenFile {
   public:
     OpenFile(int sector);		// Open a file whose header is located
@@ -80,17 +105,44 @@ class OpenFile {
     					// Read/write bytes from the file,
 					// bypassing the implicit position.
     int WriteAt(char *from, int numBytes, int position);
+					// Writing past the end makes the
+					// file longer
+
+    void Flush();			// Allocate disk space for the data
+					// written past the end, write it 
+					// out, and update the file header
 
     int Length(); 			// Return the number of bytes in the
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    int HeaderSector() { return hdrSector; }
+					// Disk sector of the file header; 
+					// identifies the file while it is open
     
   private:
-    FileHeader *hdr;			// Header for this file 
+    void ReadDisk(char *into, int numBytes, int position);
+    void WriteDisk(char *from, int numBytes, int position);
+					// Transfer bytes that lie in the
+					// file's data blocks
+    void Transfer(int first, int numSectors, char *data, bool writing);
+					// Move whole sectors of the file
+    void HoldBack(char *from, int numBytes, int position);
+					// Keep bytes past the data blocks
+					// in memory, until Flush
+    void GiveBack();			// Free the blocks past the end
+
+    OpenHeader *shared;			// What is kept of the file while
+					// it is open
+    FileHeader *hdr;			// Header for this file, shared->hdr
+    int hdrSector;			// Where "hdr" lives on disk
     int seekPosition;			// Current position within the file
 };
 
+extern bool FileIsOpen(int sector);	// Is the file whose header is at
+					// "sector" open?
+
 #endif // FILESYS
 
 #endif // OPENFILE_H
@@ -5,10 +5,13 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	The physical disk can only handle one operation at a time, so
+//	requests wait in a queue, and the interrupt handler starts the
+//	next one (in the order given by diskSchedPolicy) as each
+//	finishes.  Each request has a semaphore on which its thread
+//	waits for the interrupt.  A lock protects the buffer cache; it is
+//	not held during I/O, so that several threads can have requests
+//	queued at once.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +19,9 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
+
+DiskSchedPolicy diskSchedPolicy = FCFS;
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -31,10 +37,25 @@ DiskRequestDone (int arg)
     disk->RequestDone();
 }
 
+//----------------------------------------------------------------------
+// DiskFlusher
+// 	Body of the thread that writes dirty buffers back in the
+//	background.  Again a C routine, to be passed to Thread::Fork.
+//----------------------------------------------------------------------
+
+static void
+DiskFlusher (int arg)
+{
+    SynchDisk* disk = (SynchDisk *)arg;
+
+    disk->Flusher();
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
-//	initializing the physical disk.
+//	initializing the physical disk, the buffer cache, and the thread
+//	that flushes it.
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
@@ -42,28 +63,47 @@ DiskRequestDone (int arg)
 
 SynchDisk::SynchDisk(char* name)
 {
-    semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
+    ioDone = new Condition("synch disk io");
     disk = new Disk(name, DiskRequestDone, (int) this);
+    queue = NULL;
+    active = NULL;
+    headSector = 0;
+    cache = new BufferCache();
+    numDirty = 0;
+    flushRequest = new Semaphore("disk flush", 0);
+    flushPending = FALSE;
+    lastFlush = 0;
+
+    Thread *t = new Thread("disk flusher");
+    t->Fork(DiskFlusher, (int) this);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction.  Nachos is halting, so there is no waiting for disk
+//	interrupts any more: dirty buffers are written out directly.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
 {
+    for (int i = 0; i < cache->NumBuffers(); i++) {
+	CacheBuffer *buf = cache->Buffer(i);
+	if (buf->valid && buf->dirty)
+	    disk->WriteNow(buf->sector, buf->data);
+    }
+    delete cache;
+    delete flushRequest;
     delete disk;
+    delete ioDone;
     delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
 // 	Read the contents of a disk sector into a buffer.  Return only
-//	after the data has been read.
+//	after the data has been read -- from the cache if it is there.
 //
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
@@ -72,16 +112,16 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    lock->Acquire();
+    CacheBuffer *buf = GetBuffer(sectorNumber, TRUE);
+    bcopy(buf->data, data, SectorSize);
     lock->Release();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
-// 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+// 	Write the contents of a buffer into a disk sector.  The new
+//	contents go into the cache, and reach the disk later.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -90,20 +130,600 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    WriteSectors(sectorNumber, 1, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read "numSectors" consecutive sectors into "data".  Sectors in
+//	the cache are copied from there; each run of sectors that are
+//	not is read with one disk request.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int numSectors, char* data)
+{
+    int i = 0;
+
+    lock->Acquire();
+    while (i < numSectors) {
+	CacheBuffer *buf = cache->Find(sectorNumber + i);
+	if (buf == NULL)
+	    i += ReadRun(sectorNumber + i, numSectors - i, 
+						&data[i * SectorSize]);
+	else if (buf->busy)
+	    ioDone->Wait(lock);
+	else {
+	    stats->numCacheHits++;
+	    cache->Touch(buf);
+	    bcopy(buf->data, &data[i * SectorSize], SectorSize);
+	    i++;
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write "numSectors" consecutive sectors from "data".  Like
+//	WriteSector, this only updates the cache; Flush sends runs of
+//	dirty sectors to the disk together.
+//
+//	Inside a metadata operation, the sectors are held for the
+//	journal; first make sure it has room for them.  Between Suspend
+//	and Resume, on the other hand, they are file data for blocks the
+//	operation allocated, and go to the disk right away, before the
+//	operation can commit.  A big write is done in pieces, so that
+//	each piece fits.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int numSectors, char* data)
+{
+    bool logging = (journal != NULL && journal->Logging());
+    bool ordered = (journal != NULL && journal->Ordered());
+    int piece = ordered ? MaxRunSectors : MaxHeldSectors / 2;
+    CacheBuffer *bufs[MaxRunSectors];
+    int count = 0;
+
+    if ((logging || ordered) && numSectors > piece) {
+	for (int i = 0; i < numSectors; i += piece)
+	    WriteSectors(sectorNumber + i, min(piece, numSectors - i),
+						&data[i * SectorSize]);
+	return;
+    }
+    if (logging)
+	journal->MakeRoom(numSectors);
+    lock->Acquire();
+    for (int i = 0; i < numSectors; i++) {
+	CacheBuffer *buf = GetBuffer(sectorNumber + i, FALSE);
+	if (logging && !buf->held) {	// hold it until it is committed
+	    buf->held = TRUE;
+	    buf->pinCount++;
+	    journal->Add(sectorNumber + i, buf->dirty ? buf->data : NULL);
+	}
+	bcopy(&data[i * SectorSize], buf->data, SectorSize);
+	if (!buf->dirty) {
+	    buf->dirty = TRUE;
+	    numDirty++;
+	}
+	if (ordered && !buf->held) {	// a held one is logged anyway
+	    buf->busy = TRUE;
+	    bufs[count++] = buf;
+	}
+    }
+    if (count > 0)
+	WriteThrough(bufs, count);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadRun
+// 	"sectorNumber" is not in the cache.  Claim buffers for it and
+//	for as many of the following (up to "numSectors", at most
+//	MaxRunSectors) as are also missing, read them all with one
+//	request, and copy them out to "data".  Return the number of
+//	sectors read; 0 if we had to wait first, and the caller should
+//	look again.  Called, and returns, with "lock" held.
+//----------------------------------------------------------------------
+
+int
+SynchDisk::ReadRun(int sectorNumber, int numSectors, char* data)
+{
+    CacheBuffer *bufs[MaxRunSectors];
+    char *vector[MaxRunSectors];
+    int i, n = 0;
+
+    while (n < numSectors && n < MaxRunSectors
+		&& (n == 0 || cache->Find(sectorNumber + n) == NULL)) {
+	CacheBuffer *buf = cache->Victim();
+	if (buf == NULL)
+	    break;
+	if (buf->valid && buf->dirty) {
+	    if (n == 0)
+		WriteBack(buf);		// lock dropped; caller retries
+	    break;
+	}
+	cache->Rename(buf, sectorNumber + n);
+	cache->Touch(buf);
+	buf->busy = TRUE;
+	bufs[n] = buf;
+	vector[n++] = buf->data;
+    }
+    if (n == 0) {
+	if (cache->Victim() == NULL)	// all pinned or busy
+	    ioDone->Wait(lock);
+	return 0;
+    }
+
+    stats->numCacheMisses += n;
+    lock->Release();
+    Wait(SubmitVector(sectorNumber, n, vector, FALSE));
+    lock->Acquire();
+    for (i = 0; i < n; i++) {
+	bcopy(bufs[i]->data, &data[i * SectorSize], SectorSize);
+	bufs[i]->busy = FALSE;
+    }
+    ioDone->Broadcast(lock);
+    return n;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::GetBuffer
+// 	Return the buffer holding "sectorNumber", recycling the least
+//	recently used one (after writing it back, if dirty) on a miss.
+//
+//	"lock" is released while waiting for the disk, so the cache can
+//	change underneath us; after any wait, look the sector up again.
+//	A buffer with I/O in progress is marked busy, and anyone else
+//	wanting it waits on "ioDone".
+//
+//	"fill" -- read the sector in on a miss; not needed when the
+//	   caller is about to overwrite the whole sector
+//----------------------------------------------------------------------
+
+CacheBuffer *
+SynchDisk::GetBuffer(int sectorNumber, bool fill)
+{
+    CacheBuffer *buf;
+
+    for (;;) {
+	buf = cache->Find(sectorNumber);
+	if (buf != NULL) {
+	    if (buf->busy) {		// someone else is doing its I/O
+		ioDone->Wait(lock);
+		continue;
+	    }
+	    stats->numCacheHits++;
+	    cache->Touch(buf);
+	    return buf;
+	}
+	buf = cache->Victim();
+	if (buf == NULL) {		// all pinned or busy; wait for I/O
+	    ioDone->Wait(lock);
+	    continue;
+	}
+	if (buf->valid && buf->dirty) {
+	    WriteBack(buf);
+	    continue;
+	}
+	break;
+    }
+    stats->numCacheMisses++;
+    cache->Rename(buf, sectorNumber);
+    cache->Touch(buf);
+    if (fill) {
+	buf->busy = TRUE;
+	lock->Release();
+	RawRead(sectorNumber, buf->data);
+	lock->Acquire();
+	buf->busy = FALSE;
+	ioDone->Broadcast(lock);
+    }
+    return buf;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteBack
+// 	Write a dirty buffer to disk.  The buffer is busy meanwhile, so
+//	nobody changes it while the disk is copying it.  The caller
+//	holds "lock"; it is released during the write.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteBack(CacheBuffer *buf)
+{
+    buf->busy = TRUE;
+    lock->Release();
+    RawWrite(buf->sector, buf->data);
+    lock->Acquire();
+    buf->busy = FALSE;
+    buf->dirty = FALSE;
+    numDirty--;
+    ioDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteThrough
+// 	Write "count" dirty buffers, sorted by sector and already marked
+//	busy, to disk, and wait until they are there.  Consecutive
+//	sectors go out as one request.  The caller holds "lock"; it is
+//	released during the writes.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteThrough(CacheBuffer **bufs, int count)
+{
+    char *vector[MaxRunSectors];
+    DiskRequest *requests[MaxRunSectors];
+    int i, j, numRequests = 0;
+
+    ASSERT(count <= MaxRunSectors);
+    for (i = 0; i < count; i = j) {
+	vector[i] = bufs[i]->data;
+	for (j = i + 1; j < count
+			&& bufs[j]->sector == bufs[j - 1]->sector + 1; j++)
+	    vector[j] = bufs[j]->data;
+	requests[numRequests++] = 
+		SubmitVector(bufs[i]->sector, j - i, &vector[i], TRUE);
+    }
+    lock->Release();
+    for (i = 0; i < numRequests; i++)
+	Wait(requests[i]);
+    lock->Acquire();
+    for (i = 0; i < count; i++) {
+	bufs[i]->busy = FALSE;
+	bufs[i]->dirty = FALSE;
+	numDirty--;
+    }
+    ioDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Pin/Unpin
+// 	Keep a (hot) sector in the cache, for instance a file header
+//	that every file system operation reads; or let it go again.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Pin(int sectorNumber)
+{
+    lock->Acquire();
+    GetBuffer(sectorNumber, TRUE)->pinCount++;
+    lock->Release();
+}
+
+void
+SynchDisk::Unpin(int sectorNumber)
+{
+    lock->Acquire();
+    CacheBuffer *buf = cache->Find(sectorNumber);
+    ASSERT(buf != NULL && buf->pinCount > 0);
+    buf->pinCount--;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Release
+// 	The journal has committed the transaction that changed a held
+//	sector; treat it as an ordinary dirty buffer from now on.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Release(int sectorNumber)
+{
+    lock->Acquire();
+    CacheBuffer *buf = cache->Find(sectorNumber);
+    ASSERT(buf != NULL && buf->held && buf->pinCount > 0);
+    buf->held = FALSE;
+    buf->pinCount--;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write every dirty buffer back to disk.  Dirty buffers holding
+//	consecutive sectors go out together, as one request; all the
+//	requests are queued before waiting for any of them, so the
+//	scheduler can sort them into one sweep across the disk.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    int n = cache->NumBuffers();
+    CacheBuffer **bufs = new CacheBuffer *[n];
+    char **vector = new char *[n];
+    DiskRequest **requests = new DiskRequest *[n];
+    int i, j, count = 0, numRequests = 0;
+
+    lock->Acquire();
+    DEBUG('f', "Flushing %d dirty sectors\n", numDirty);
+    for (i = 0; i < n; i++) {
+	CacheBuffer *buf = cache->Buffer(i);
+	if (buf->valid && buf->dirty && !buf->busy && !buf->held) {
+	    buf->busy = TRUE;
+	    for (j = count++; j > 0 && bufs[j - 1]->sector > buf->sector; j--)
+		bufs[j] = bufs[j - 1];	// keep them sorted by sector
+	    bufs[j] = buf;
+	}
+    }
+    for (i = 0; i < count; i = j) {
+	vector[i] = bufs[i]->data;
+	for (j = i + 1; j < count && j - i < MaxRunSectors
+			&& bufs[j]->sector == bufs[j - 1]->sector + 1; j++)
+	    vector[j] = bufs[j]->data;
+	requests[numRequests++] = 
+		SubmitVector(bufs[i]->sector, j - i, &vector[i], TRUE);
+    }
+    lock->Release();
+    for (i = 0; i < numRequests; i++)
+	Wait(requests[i]);
+    lock->Acquire();
+    for (i = 0; i < count; i++) {
+	bufs[i]->busy = FALSE;
+	bufs[i]->dirty = FALSE;
+	numDirty--;
+    }
+    if (count > 0)
+	ioDone->Broadcast(lock);
+    lock->Release();
+    disk->Sync();			// a mapped image goes out now
+    delete [] requests;
+    delete [] vector;
+    delete [] bufs;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WaitForWrites
+// 	Wait until no dirty buffer, other than those the journal holds,
+//	is being written out.  Flush skips a buffer that is busy -- with
+//	an eviction's write-back, say, or another Flush -- so a caller
+//	that must know every committed sector is home waits for those
+//	writes to finish, and then flushes again.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WaitForWrites()
+{
+    lock->Acquire();
+    for (int i = 0; i < cache->NumBuffers(); i++) {
+	CacheBuffer *buf = cache->Buffer(i);
+	if (buf->valid && buf->dirty && buf->busy && !buf->held) {
+	    ioDone->Wait(lock);
+	    i = -1;			// look again from the start
+	}
+    }
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchDisk::WakeFlusher
+// 	Called by the timer interrupt handler.  If there are dirty
+//	buffers and the last flush was long enough ago, wake up the
+//	flusher thread.  (We can't do the I/O here: an interrupt handler
+//	must not wait.)
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WakeFlusher()
+{
+    if (numDirty == 0 || flushPending 
+		|| stats->totalTicks - lastFlush < FlushInterval)
+	return;
+    flushPending = TRUE;
+    lastFlush = stats->totalTicks;
+    flushRequest->V();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flusher
+// 	Loop forever, writing dirty buffers back whenever woken.  The
+//	journal's running transaction is committed first, so that its
+//	sectors can go too.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flusher()
+{
+    for (;;) {
+	flushRequest->P();
+	if (journal != NULL)
+	    journal->Commit();
+	Flush();
+	flushPending = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::RawRead
+// 	Read a sector from the disk itself.  Return only after the data
+//	has been read.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::RawRead(int sectorNumber, char* data)
+{
+    Wait(Submit(sectorNumber, data, FALSE));
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::RawWrite
+// 	Write a sector to the disk itself, and wait for it.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::RawWrite(int sectorNumber, char* data)
+{
+    Wait(Submit(sectorNumber, data, TRUE));
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Queue a request for the disk, and start the disk on it if it is
+//	idle.  Return without waiting; the caller passes the result to
+//	Wait.  "data" must stay put until then.
+//
+//	"sectorNumber" -- the disk sector to read or write
+//	"data" -- the buffer to read into, or write from
+//	"writing" -- TRUE for a write
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::Submit(int sectorNumber, char* data, bool writing)
+{
+    return SubmitVector(sectorNumber, 1, &data, writing);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::SubmitVector
+// 	Queue a request for the run of "numSectors" sectors starting at
+//	"sectorNumber".  The disk moves the whole run in one operation.
+//
+//	"data" -- data[i] is the buffer for sector sectorNumber + i; the
+//	   array itself is copied, the buffers must stay put until Wait
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::SubmitVector(int sectorNumber, int numSectors, char** data,
+							bool writing)
+{
+    DiskRequest *request = new DiskRequest;
+    DiskRequest **p;
+
+    ASSERT((sectorNumber >= 0) && (numSectors > 0)
+		&& (sectorNumber + numSectors <= NumSectors));
+    request->sector = sectorNumber;
+    request->count = numSectors;
+    request->data = new char *[numSectors];
+    for (int i = 0; i < numSectors; i++)
+	request->data[i] = data[i];
+    request->writing = writing;
+    request->submitTime = stats->totalTicks;
+    if (writing)			// charged to whoever asked
+	currentThread->usage.diskWrites += numSectors;
+    else
+	currentThread->usage.diskReads += numSectors;
+    request->deadline = request->submitTime
+			+ (writing ? WriteDeadline : ReadDeadline);
+    request->doneTime = 0;
+    request->done = new Semaphore("disk request", 0);
+    request->next = NULL;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    for (p = &queue; *p != NULL; p = &(*p)->next)
+	;				// arrival order, for FCFS
+    *p = request;
+    StartNext();
+    (void) interrupt->SetLevel(oldLevel);
+    return request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Wait
+// 	Wait for a request from Submit to finish, then free it.  Return
+//	its latency -- the ticks from being queued to being done.
+//----------------------------------------------------------------------
+
+int
+SynchDisk::Wait(DiskRequest *request)
+{
+    int latency;
+
+    request->done->P();			// wait for interrupt
+    latency = request->doneTime - request->submitTime;
+    delete request->done;
+    delete [] request->data;
+    delete request;
+    return latency;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::NextRequest
+// 	Choose the queued request to serve next, according to
+//	diskSchedPolicy, and take it off the queue.  Called with
+//	interrupts off, and only when the queue is not empty.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::NextRequest()
+{
+    DiskRequest **p, **pick = &queue;
+    DiskRequest *request;
+
+    switch (diskSchedPolicy) {
+      case SSTF:
+	for (p = &queue; *p != NULL; p = &(*p)->next)
+	    if (abs((*p)->sector - headSector)
+			< abs((*pick)->sector - headSector))
+		pick = p;
+	break;
+
+      case DeadlineSched:
+	for (p = &queue; *p != NULL; p = &(*p)->next)
+	    if ((*p)->deadline < (*pick)->deadline)
+		pick = p;
+	if ((*pick)->deadline <= stats->totalTicks)
+	    break;			// overdue; serve it now
+	// otherwise fall through, and sweep as C-LOOK does
+
+      case CLOOK: {
+	DiskRequest **lowest = &queue, **ahead = NULL;
+	for (p = &queue; *p != NULL; p = &(*p)->next) {
+	    if ((*p)->sector < (*lowest)->sector)
+		lowest = p;
+	    if ((*p)->sector >= headSector
+			&& (ahead == NULL || (*p)->sector < (*ahead)->sector))
+		ahead = p;
+	}
+	pick = (ahead != NULL) ? ahead : lowest;
+	break;
+      }
+
+      default:				// FCFS: the head of the queue
+	break;
+    }
+    request = *pick;
+    *pick = request->next;
+    return request;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	If the disk is idle and requests are waiting, send it the next
+//	one.  Called with interrupts off.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartNext()
+{
+    if (active != NULL || queue == NULL)
+	return;
+    active = NextRequest();
+    DEBUG('f', "Disk %s %d sectors at %d, head was at %d\n",
+	  active->writing ? "writing" : "reading", active->count, 
+	  active->sector, headSector);
+    headSector = active->sector + active->count - 1;
+    if (active->writing)
+	disk->WriteVector(active->sector, active->count, active->data);
+    else
+	disk->ReadVector(active->sector, active->count, active->data);
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Wake up the thread waiting for the
+//	request that just finished, and start the disk on the next.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
 { 
-    semaphore->V();
+    DiskRequest *request = active;
+
+    ASSERT(request != NULL);
+    active = NULL;
+    request->doneTime = stats->totalTicks;
+    request->done->V();
+    StartNext();
 }
@@ -13,6 +13,42 @@
 
 #include "disk.h"
 #include "synch.h"
+#include "bufcache.h"
+
+#define FlushInterval	10000	// ticks between write-backs of dirty
+				// buffers by the flusher thread
+#define MaxRunSectors	16	// most sectors moved by one request
+#define ReadDeadline	20000	// ticks a read may wait under the
+#define WriteDeadline	100000	// deadline policy before it is served
+				// ahead of everything else
+
+// Order in which queued requests are sent to the disk, set with -ds.
+//
+//   FCFS -- in order of arrival
+//   SSTF -- shortest seek first: the request nearest the head
+//   CLOOK -- circular elevator: sweep towards higher sectors, then jump
+//	back to the lowest waiting request
+//   DeadlineSched -- C-LOOK, except that a request past its deadline
+//	goes first (reads expire sooner than writes)
+
+enum DiskSchedPolicy { FCFS, SSTF, CLOOK, DeadlineSched };
+
+extern DiskSchedPolicy diskSchedPolicy;
+
+// The following class defines one queued disk request.
+
+class DiskRequest {
+  public:
+    int sector;				// first sector to read or write
+    int count;				// number of consecutive sectors
+    char **data;			// where each sector goes/comes from
+    bool writing;			// write rather than read?
+    int submitTime;			// when the request was queued
+    int deadline;			// when it should be served by
+    int doneTime;			// when the disk finished it
+    Semaphore *done;			// V'ed by the interrupt handler
+    DiskRequest *next;			// next request in the queue
+};
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -24,6 +60,19 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// Underneath, requests are queued: Submit adds a request and returns
+// at once, Wait blocks until it is done.  Whenever the disk goes idle
+// the next request is chosen by diskSchedPolicy, so that concurrent
+// threads do not pay for the seeks of strictly FIFO service.
+//
+// Sectors go through a buffer cache.  Reads that hit in the cache do no
+// I/O; writes only update the cache, and dirty buffers reach the disk
+// when they are recycled, when a flusher thread (woken every 
+// FlushInterval ticks by the timer) writes them back, or at shutdown.
+// A sector written inside a journal operation is held in the cache --
+// pinned, and skipped by write-backs -- until the journal commits it
+// (cf. journal.h).
 class SynchDisk {
   public:
     SynchDisk(char* name);    		// Initialize a synchronous disk,
@@ -37,17 +86,68 @@ class SynchDisk {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+    void ReadSectors(int sectorNumber, int numSectors, char* data);
+    void WriteSectors(int sectorNumber, int numSectors, char* data);
+					// The same, for consecutive sectors;
+					// cache misses are read from the 
+					// disk in runs, one request each
+
+    void Pin(int sectorNumber);		// Keep a sector in the cache
+    void Unpin(int sectorNumber);	// Let it be recycled again
+    void Release(int sectorNumber);	// Stop holding a sector for the
+					// journal; it may be written back
+    void Flush();			// Write back every dirty buffer
+    void WaitForWrites();		// Wait for write-backs in progress
+    void WakeFlusher();			// Called from the timer interrupt
+					// handler; starts a periodic flush
+    void Flusher();			// Body of the flusher thread
+    
+    DiskRequest *Submit(int sectorNumber, char* data, bool writing);
+					// Queue a request, bypassing the
+					// cache; return without waiting
+    DiskRequest *SubmitVector(int sectorNumber, int numSectors,
+					char** data, bool writing);
+					// Queue a request for a run of
+					// sectors; data[i] holds sector
+					// sectorNumber + i
+    int Wait(DiskRequest *request);	// Wait for a submitted request to
+					// finish, free it, and return how
+					// many ticks it took
     
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
+    CacheBuffer *GetBuffer(int sectorNumber, bool fill);
+					// Find or load the buffer for a
+					// sector; caller holds "lock"
+    void WriteBack(CacheBuffer *buf);	// Write a dirty buffer out
+    void WriteThrough(CacheBuffer **bufs, int count);
+					// Write busy buffers out now
+    int ReadRun(int sectorNumber, int numSectors, char* data);
+					// Read missing sectors into the
+					// cache, as a single request
+    void RawRead(int sectorNumber, char* data);
+    void RawWrite(int sectorNumber, char* data);
+					// Do the I/O, and wait for it
+    DiskRequest *NextRequest();		// Take the request to serve next
+					// off the queue
+    void StartNext();			// If the disk is idle, start it on
+					// the next queued request
+
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskRequest *queue;			// Requests not yet sent to the disk
+    DiskRequest *active;		// The request the disk is working on
+    int headSector;			// Sector of the last request started
+    Lock *lock;		  		// Protects the cache
+    Condition *ioDone;			// Signalled when a busy buffer's
+					// I/O finishes
+    BufferCache *cache;			// Sectors held in memory
+    int numDirty;			// Number of dirty buffers
+    Semaphore *flushRequest;		// Wakes up the flusher thread
+    bool flushPending;			// Flusher woken but not done yet
+    int lastFlush;			// When the last flush started
 };
 
 #endif // SYNCHDISK_H
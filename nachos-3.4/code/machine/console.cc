@@ -4,8 +4,8 @@
 //	These are each simulated by operations on UNIX files.
 //	The simulated device is asynchronous,
 //	so we have to invoke the interrupt handler (after a simulated
-//	delay), to signal that a byte has arrived and/or that a written
-//	byte has departed.
+//	delay), to signal that bytes have arrived and/or that written
+//	bytes have departed.
 //
 //  DO NOT CHANGE -- part of the machine emulation
 //
@@ -53,7 +53,8 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     readHandler = readAvail;
     handlerArg = callArg;
     putBusy = FALSE;
-    incoming = EOF;
+    putCount = 0;
+    inHead = inCount = 0;
 
     // start polling for incoming packets
     interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, ConsoleReadInt);
@@ -74,33 +75,35 @@ Console::~Console()
 
 //----------------------------------------------------------------------
 // Console::CheckCharAvail()
-// 	Periodically called to check if a character is available for
-//	input from the simulated keyboard (eg, has it been typed?).
+// 	Periodically called to check if characters are available for
+//	input from the simulated keyboard (eg, have they been typed?).
 //
-//	Only read it in if there is buffer space for it (if the previous
-//	character has been grabbed out of the buffer by the Nachos kernel).
-//	Invoke the "read" interrupt handler, once the character has been 
-//	put into the buffer. 
+//	Read in as many as have been typed and fit in the input buffer,
+//	with one read.  Invoke the "read" interrupt handler once for each
+//	character just read -- not again for ones still buffered from an
+//	earlier poll, which would tell a caller taking one character per
+//	interrupt that there are more than there are.
 //----------------------------------------------------------------------
 
 void
 Console::CheckCharAvail()
 {
-    char c;
-
     // schedule the next time to poll for a packet
     interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, 
 			ConsoleReadInt);
 
-    // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
-	return;	  
-
-    // otherwise, read character and tell user about it
-    Read(readFileNo, &c, sizeof(char));
-    incoming = c ;
-    stats->numConsoleCharsRead++;
-    (*readHandler)(handlerArg);	
+    // read what there is, into the free space after the buffered chars
+    if (inCount < ConsoleInputSize && PollFile(readFileNo)) {
+	int tail = (inHead + inCount) % ConsoleInputSize;
+	int room = min(ConsoleInputSize - inCount, ConsoleInputSize - tail);
+	int n = ReadPartial(readFileNo, &incoming[tail], room);
+	if (n > 0) {
+	    inCount += n;
+	    stats->numConsoleCharsRead += n;
+	}
+	for (int i = 0; i < n; i++)
+	    (*readHandler)(handlerArg);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -114,7 +117,7 @@ void
 Console::WriteDone()
 {
     putBusy = FALSE;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleCharsWritten += putCount;
     (*writeHandler)(handlerArg);
 }
 
@@ -127,9 +130,13 @@ Console::WriteDone()
 char
 Console::GetChar()
 {
-   char ch = incoming;
+   char ch;
 
-   incoming = EOF;
+   if (inCount == 0)
+	return EOF;
+   ch = incoming[inHead];
+   inHead = (inHead + 1) % ConsoleInputSize;
+   inCount--;
    return ch;
 }
 
@@ -141,10 +148,23 @@ Console::GetChar()
 
 void
 Console::PutChar(char ch)
+{
+    PutChars(&ch, 1);
+}
+
+//----------------------------------------------------------------------
+// Console::PutChars()
+// 	Write "numChars" characters to the simulated display with a single
+//	UNIX write, and schedule a single interrupt for all of them.
+//----------------------------------------------------------------------
+
+void
+Console::PutChars(char *from, int numChars)
 {
     ASSERT(putBusy == FALSE);
-    WriteFile(writeFileNo, &ch, sizeof(char));
+    WriteFile(writeFileNo, from, numChars);
     putBusy = TRUE;
+    putCount = numChars;
     interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
 					ConsoleWriteInt);
 }
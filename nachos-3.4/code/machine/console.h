@@ -14,6 +14,14 @@
 //	for read and write, and the device is "duplex" -- a character
 //	can be outgoing and incoming at the same time.
 //
+//	Like a UART with FIFOs, the device also moves characters in bulk:
+//	PutChars sends a whole buffer with one write to the UNIX file and
+//	one completion interrupt, and the keyboard is read as many
+//	characters at a time as have been typed, into an input buffer of
+//	ConsoleInputSize characters that GetChar drains.  The read
+//	handler is still called once per character that comes in, so a
+//	user that takes one character per call gets each exactly once.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -26,6 +34,8 @@
 #include "copyright.h"
 #include "utility.h"
 
+#define ConsoleInputSize	256	// characters buffered from the keyboard
+
 // The following class defines a hardware console device.
 // Input and output to the device is simulated by reading 
 // and writing to UNIX files ("readFile" and "writeFile").
@@ -46,11 +56,17 @@ class Console {
     void PutChar(char ch);	// Write "ch" to the console display, 
 				// and return immediately.  "writeHandler" 
 				// is called when the I/O completes. 
+    void PutChars(char *from, int numChars);
+				// Likewise, for "numChars" characters at
+				// once; "from" must stay untouched until
+				// "writeHandler" is called
 
     char GetChar();	   	// Poll the console input.  If a char is 
 				// available, return it.  Otherwise, return EOF.
     				// "readHandler" is called whenever there is 
 				// a char to be gotten
+    int NumAvail() { return inCount; }
+				// Characters that GetChar can return
 
 // internal emulation routines -- DO NOT call these. 
     void WriteDone();	 	// internal routines to signal I/O completion
@@ -67,9 +83,10 @@ class Console {
 					// interrupt handlers
     bool putBusy;    			// Is a PutChar operation in progress?
 					// If so, you can't do another one!
-    char incoming;    			// Contains the character to be read,
-					// if there is one available. 
-					// Otherwise contains EOF.
+    int putCount;			// characters in that operation
+    char incoming[ConsoleInputSize];	// Characters read from the keyboard,
+    int inHead;				// not yet gotten: a ring of "inCount"
+    int inCount;			// characters starting at "inHead"
 };
 
 #endif // CONSOLE_H
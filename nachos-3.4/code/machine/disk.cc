@@ -25,6 +25,8 @@
 
 #define DiskSize 	(MagicSize + (NumSectors * SectorSize))
 
+DiskBacking diskBacking = DiskFile;
+
 // dummy procedure because we can't take a pointer of a member function
 static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 
@@ -34,6 +36,10 @@ static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 //	if it doesn't exist), and check the magic number to make sure it's 
 // 	ok to treat it as Nachos disk storage.
 //
+//	A disk file left by an older, smaller disk (cf. NumTracks) is
+//	padded out to DiskSize with zeroes, so that reads past its old
+//	end do not hit EOF and a mapped image does not fault there.
+//
 //	"name" -- text name of the file simulating the Nachos disk
 //	"callWhenDone" -- interrupt handler to be called when disk read/write
 //	   request completes
@@ -55,6 +61,10 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
     if (fileno >= 0) {		 	// file exists, check magic number 
 	Read(fileno, (char *) &magicNum, MagicSize);
 	ASSERT(magicNum == MagicNumber);
+	int oldSize = ExtendFile(fileno, DiskSize);
+	if (oldSize < DiskSize)
+	    DEBUG('d', "Extended the disk file from %d to %d bytes\n",
+		  oldSize, DiskSize);
     } else {				// file doesn't exist, create it
         fileno = OpenForWrite(name);
 	magicNum = MagicNumber;  
@@ -64,20 +74,70 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
         Lseek(fileno, DiskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
+    image = NULL;
+    if (diskBacking != DiskFile)
+	image = MapFile(fileno, DiskSize);
     active = FALSE;
 }
 
 //----------------------------------------------------------------------
 // Disk::~Disk()
 // 	Clean up disk simulation, by closing the UNIX file representing the
-//	disk.
+//	disk.  A mapped image is written back and unmapped first.
 //----------------------------------------------------------------------
 
 Disk::~Disk()
 {
+    if (image != NULL) {
+	Sync();
+	UnmapFile(image, DiskSize);
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Sync()
+// 	Make sure the UNIX file holds everything written to a mapped
+//	disk image.  Nothing to do if the disk is not mapped: every
+//	write has already gone to the file.
+//----------------------------------------------------------------------
+
+void
+Disk::Sync()
+{
+    if (image != NULL)
+	SyncMapping(image, 0, DiskSize);
+}
+
+//----------------------------------------------------------------------
+// Disk::Transfer
+// 	Move the data for "numSectors" sectors starting at "sectorNumber"
+//	between the buffers and the UNIX file -- with one vectored system
+//	call, or, if the file is mapped, by copying.
+//----------------------------------------------------------------------
+
+void
+Disk::Transfer(int sectorNumber, int numSectors, char** data, bool writing)
+{
+    int offset = SectorSize * sectorNumber + MagicSize;
+
+    if (image == NULL) {
+	if (writing)
+	    ::WriteVector(fileno, offset, data, numSectors, SectorSize);
+	else
+	    ::ReadVector(fileno, offset, data, numSectors, SectorSize);
+	return;
+    }
+    for (int i = 0; i < numSectors; i++) {
+	if (writing)
+	    bcopy(data[i], &image[offset + i * SectorSize], SectorSize);
+	else
+	    bcopy(&image[offset + i * SectorSize], data[i], SectorSize);
+    }
+    if (writing && diskBacking == DiskMappedSync)
+	SyncMapping(image, offset, numSectors * SectorSize);
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -115,43 +175,85 @@ PrintSector (bool writing, int sector, char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    ReadVector(sectorNumber, 1, &data);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, char* data)
+{
+    WriteVector(sectorNumber, 1, &data);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadVector/WriteVector
+// 	Simulate a request to read/write "numSectors" consecutive
+//	sectors, starting at "sectorNumber".  On the UNIX side this is
+//	one vectored read or write; the simulated disk charges one seek
+//	and rotational delay for the whole run (cf. RunLatency), and
+//	interrupts once, when the last sector is done.
+//
+//	"data" -- data[i] is the buffer for sector sectorNumber + i
+//----------------------------------------------------------------------
+
+void
+Disk::ReadVector(int sectorNumber, int numSectors, char** data)
+{
+    int ticks = RunLatency(sectorNumber, numSectors, FALSE);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0)
+		&& (sectorNumber + numSectors <= NumSectors));
     
-    DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    DEBUG('d', "Reading %d sectors from sector %d\n", numSectors, sectorNumber);
+    Transfer(sectorNumber, numSectors, data, FALSE);
     if (DebugIsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(FALSE, sectorNumber + i, data[i]);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
-    stats->numDiskReads++;
+    UpdateRun(sectorNumber, numSectors, ticks);
+    stats->numDiskReads += numSectors;
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteVector(int sectorNumber, int numSectors, char** data)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int ticks = RunLatency(sectorNumber, numSectors, TRUE);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0)
+		&& (sectorNumber + numSectors <= NumSectors));
     
-    DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    DEBUG('d', "Writing %d sectors to sector %d\n", numSectors, sectorNumber);
+    Transfer(sectorNumber, numSectors, data, TRUE);
     if (DebugIsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(TRUE, sectorNumber + i, data[i]);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
-    stats->numDiskWrites++;
+    UpdateRun(sectorNumber, numSectors, ticks);
+    stats->numDiskWrites += numSectors;
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
+//----------------------------------------------------------------------
+// Disk::WriteNow
+// 	Write a sector straight to the UNIX file, outside of the usual
+//	request/interrupt protocol.  Used when Nachos is halting, and
+//	there is no longer a thread that could wait for an interrupt.
+//----------------------------------------------------------------------
+
+void
+Disk::WriteNow(int sectorNumber, char* data)
+{
+    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    
+    DEBUG('d', "Flushing sector %d\n", sectorNumber);
+    Transfer(sectorNumber, 1, &data, TRUE);
+    stats->numDiskWrites++;
+}
+
 //----------------------------------------------------------------------
 // Disk::HandleInterrupt()
 // 	Called when it is time to invoke the disk interrupt handler,
@@ -252,6 +354,47 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::RunLatency()
+// 	Return how long a request for "numSectors" consecutive sectors
+//	starting at "newSector" will take.  After the first sector, the
+//	rest pass under the head back to back, one per RotationTime;
+//	crossing onto the next track costs a one-track seek (we assume
+//	the tracks are skewed so that no extra rotation is lost).
+//----------------------------------------------------------------------
+
+int
+Disk::RunLatency(int newSector, int numSectors, bool writing)
+{
+    int ticks = ComputeLatency(newSector, writing);
+
+    for (int i = 1; i < numSectors; i++) {
+	if ((newSector + i) % SectorsPerTrack == 0)
+	    ticks += SeekTime;
+	ticks += RotationTime;
+    }
+    return ticks;
+}
+
+//----------------------------------------------------------------------
+// Disk::UpdateRun
+//   	Like UpdateLast, for a run of sectors that will take "ticks" to
+//	transfer.  If the run ends on a later track than it started, the
+//	track buffer started loading that track when the head got there.
+//----------------------------------------------------------------------
+
+void
+Disk::UpdateRun(int newSector, int numSectors, int ticks)
+{
+    int last = newSector + numSectors - 1;
+
+    UpdateLast(newSector);
+    if (last / SectorsPerTrack != newSector / SectorsPerTrack)
+	bufferInit = stats->totalTicks + ticks 
+			- ((last % SectorsPerTrack) + 1) * RotationTime;
+    lastSector = last;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
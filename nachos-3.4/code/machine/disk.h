@@ -48,10 +48,21 @@
 
 #define SectorSize 		128	// number of bytes per disk sector
 #define SectorsPerTrack 	32	// number of sectors per disk track 
-#define NumTracks 		32	// number of tracks per disk
+#define NumTracks 		512	// number of tracks per disk
 #define NumSectors 		(SectorsPerTrack * NumTracks)
 					// total # of sectors per disk
 
+// Normally each request reads or writes the UNIX file with system calls.
+// With "-dm", the file is mapped into memory instead, and requests are
+// just copies into the mapping; the mapping is forced out to the file
+// by Sync (called when the file system flushes its cache) and when the
+// disk goes away.  With "-dms", every write is forced out as it is made,
+// so the UNIX file is always up to date, as in the unmapped case.
+
+enum DiskBacking { DiskFile, DiskMapped, DiskMappedSync };
+
+extern DiskBacking diskBacking;		// set with -dm/-dms
+
 class Disk {
   public:
     Disk(char* name, VoidFunctionPtr callWhenDone, int callArg);
@@ -67,6 +78,22 @@ class Disk {
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
 
+    void ReadVector(int sectorNumber, int numSectors, char** data);
+    void WriteVector(int sectorNumber, int numSectors, char** data);
+    					// Read/write a run of consecutive
+					// sectors as one request: one seek,
+					// then a sector per rotation time,
+					// and a single interrupt at the end.
+					// data[i] holds sector 
+					// sectorNumber + i.
+
+    void WriteNow(int sectorNumber, char* data);
+    					// Write a sector at once, with no
+					// interrupt; only for flushing 
+					// caches when Nachos shuts down
+    void Sync();			// Force a mapped disk image out
+					// to the UNIX file
+
     void HandleInterrupt();		// Interrupt handler, invoked when
 					// disk request finishes.
 
@@ -74,9 +101,13 @@ class Disk {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int RunLatency(int newSector, int numSectors, bool writing);
+					// The same, for a run of sectors
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    char *image;			// The file mapped into memory, or
+					// NULL if it is not mapped
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
     int handlerArg;			// Argument to interrupt handler 
@@ -88,6 +119,10 @@ class Disk {
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
+    void UpdateRun(int newSector, int numSectors, int ticks);
+    void Transfer(int sectorNumber, int numSectors, char** data,
+						bool writing);
+					// Copy data to/from the UNIX file
 };
 
 #endif // DISK_H
@@ -152,13 +152,15 @@ Interrupt::OneTick()
 {
     MachineStatus old = status;
 
-// advance simulated time
+// advance simulated time, and charge it to the running thread
     if (status == SystemMode) {
         stats->totalTicks += SystemTick;
 	stats->systemTicks += SystemTick;
+	currentThread->usage.systemTicks += SystemTick;
     } else {					// USER_PROGRAM
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
+	currentThread->usage.userTicks += UserTick;
     }
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
@@ -175,6 +177,10 @@ Interrupt::OneTick()
               
 	yieldOnReturn = FALSE;
  	status = SystemMode;		// yield is a kernel routine
+#ifdef USER_PROGRAM
+	if (old == UserMode)		// a program's time slice is over:
+	    EnforceCpuLimit();		// the time to check its CPU limit,
+#endif					// before it waits for another
 	currentThread->Yield();
 	status = old;
     }
@@ -231,7 +237,7 @@ Interrupt::Idle()
 
     DEBUG('i', "Machine idle.  No interrupts to do.\n");
     #ifdef USER_PROGRAM
-    printf("TLB:  Hit %d, Miss %d\n", machine->hitTime, machine->missTime);
+    machine->PrintTLBStats();
     #endif
     printf("No threads ready or runnable, and no pending interrupts.\n");
     printf("Assuming the program completed.\n");
@@ -247,6 +253,9 @@ Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+#ifdef USER_PROGRAM
+    processTable->Print();
+#endif
     Cleanup();     // Never returns.
 }
 
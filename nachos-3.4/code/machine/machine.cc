@@ -11,6 +11,12 @@
 #include "machine.h"
 #include "system.h"
 
+// Size of the simulated memory and TLB; see machine.h.
+int PageSize = DefaultPageSize;
+int NumPhysPages = DefaultNumPhysPages;
+int TLBSize = DefaultTLBSize;
+int TLBWays = DefaultTLBWays;
+
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
 static char* exceptionNames[] = { "no exception", "syscall", 
@@ -56,6 +62,11 @@ Machine::Machine(bool debug)
 {
     int i;
 
+    ASSERT(PageSize > 0 && PageSize % 4 == 0);
+    ASSERT(NumPhysPages > 0 && TLBSize > 0);
+    DEBUG('a', "Machine: %d frames of %d bytes, %d TLB entries\n",
+          NumPhysPages, PageSize, TLBSize);
+
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
     mainMemory = new char[MemorySize];
@@ -68,18 +79,36 @@ Machine::Machine(bool debug)
     for (i = 0; i < NumPhysPages; ++i) {
            physPageTable[i].vaPageNum = -1;
            physPageTable[i].valid = FALSE;
+           physPageTable[i].dirty = FALSE;
+           physPageTable[i].lastUsedTime = 0;
+           physPageTable[i].space = NULL;
     }
+    asidMap = new BitMap(NumASIDs);
+    asidSpace = new AddrSpace *[NumASIDs];
+    tlbHits = new int[NumASIDs];
+    tlbMisses = new int[NumASIDs];
+    for (i = 0; i < NumASIDs; i++) {
+        asidSpace[i] = NULL;
+        tlbHits[i] = tlbMisses[i] = 0;
+    }
+    retiredHits = retiredMisses = 0;
+    currentASID = 0;
+    llAddr = 0;
+    llBit = FALSE;
 #ifdef USE_TLB
+    if (TLBWays > TLBSize)
+        TLBWays = TLBSize;
+    ASSERT(TLBWays > 0 && TLBSize % TLBWays == 0);
+    tlbSets = TLBSize / TLBWays;
     tlb = new TranslationEntry[TLBSize];
     for (i = 0; i < TLBSize; i++)
     tlb[i].valid = FALSE;
 
     pageTable = NULL;
-    hitTime = 0;
-    missTime = 0;
-    printf("TLB USE\n");
+    DEBUG('a', "TLB: %d sets x %d ways\n", tlbSets, TLBWays);
 #else   // use linear page table
     tlb = NULL;
+    tlbSets = 0;
     pageTable = NULL;
     printf("TLB NOT USE\n");
 #endif
@@ -98,6 +127,12 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
+    delete [] physPageTable;
+    delete mBitMap;
+    delete asidMap;
+    delete [] asidSpace;
+    delete [] tlbHits;
+    delete [] tlbMisses;
     if (tlb != NULL)
         delete [] tlb;
 }
@@ -120,6 +155,7 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
 //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);          // finish anything in progress
+    llBit = FALSE;              // breaks any LL/SC sequence
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);        // interrupts are enabled at this point
     interrupt->setStatus(UserMode);
@@ -227,32 +263,81 @@ void Machine::WriteRegister(int num, int value)
     registers[num] = value;
     }
 
+//----------------------------------------------------------------------
+// Machine::TLBSet / TLBLookup
+//  The TLB is organized as "tlbSets" sets of "TLBWays" entries; a 
+//  virtual page can only live in set (vpn % tlbSets), so a lookup 
+//  probes TLBWays entries rather than the whole TLB.  Entries are 
+//  tagged with the ASID of their address space, so that they stay 
+//  valid across context switches.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+Machine::TLBSet(int vpn)
+{
+    return &tlb[((unsigned) vpn % tlbSets) * TLBWays];
+}
+
+TranslationEntry *
+Machine::TLBLookup(int vpn)
+{
+    TranslationEntry *set = TLBSet(vpn);
+
+    for (int i = 0; i < TLBWays; i++)
+        if (set[i].valid && set[i].virtualPage == vpn 
+                && set[i].asid == currentASID)
+            return &set[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Machine::TLBWriteBack
+//  A TLB entry is leaving the TLB; fold the use and dirty bits 
+//  gathered while it was cached into the page table of the address 
+//  space it belongs to (which need not be the running one).  Entries 
+//  whose page has since moved are simply dropped.
+//----------------------------------------------------------------------
+
+void
+Machine::TLBWriteBack(TranslationEntry *entry)
+{
+    AddrSpace *space = asidSpace[entry->asid];
+
+    if (space == NULL)
+        return;
+    TranslationEntry *pte = space->pageTable->Lookup(entry->virtualPage);
+    if (pte == NULL || !pte->valid || pte->physicalPage != entry->physicalPage)
+        return;
+    pte->use = pte->use || entry->use;
+    pte->dirty = pte->dirty || entry->dirty;
+    pte->lastUsedTime = entry->lastUsedTime;
+}
+
  void Machine::LRUSwapTLB(int badVAddr)
  {
-               //printf("Bad Address 0x%x\n", badVAddr);
                unsigned int vpn = (unsigned) badVAddr / PageSize;    // 虚拟页号
-               int minTime = tlb[0].lastUsedTime;
-               TranslationEntry *entry = &tlb[0];          //  将要替换掉的页表项
-               // 遍历TLB找到一个vaild为false，或者最后一次使用时间距离现在最长的，即最后一次使用时间最小的
-               for (int i = 0; i < TLBSize; ++i) {
-                      if (tlb[i].valid == false) {
-                              entry = &tlb[i];
+               TranslationEntry *set = TLBSet(vpn);
+               TranslationEntry *entry = &set[0];          //  将要替换掉的页表项
+               // 在vpn所在的组中找到一个vaild为false，或者最后一次使用时间最小的
+               for (int i = 0; i < TLBWays; ++i) {
+                      if (set[i].valid == false) {
+                              entry = &set[i];
                               break;
                       }
-                      else if (tlb[i].lastUsedTime < minTime) {
-                              minTime = tlb[i].lastUsedTime;
-                              entry = &tlb[i];
-                      }
+                      else if (set[i].lastUsedTime < entry->lastUsedTime)
+                              entry = &set[i];
                }
                // 将TLB中将要替换下去的页表项的内容写回页表
                if (entry->valid)
-                      pageTable[entry->virtualPage] = *entry;                     
-               if (pageTable[vpn].valid)
-                      *entry = pageTable[vpn];                        
-               else {
+                      TLBWriteBack(entry);
+               TranslationEntry *pte = pageTable->Lookup(vpn);
+               if (pte == NULL || !pte->valid) {
                       AllocatePhysPage(badVAddr);
-                      *entry = pageTable[vpn];
-               } 
+                      pte = pageTable->Lookup(vpn);
+               }
+               *entry = *pte;
+               entry->asid = currentASID;
+               entry->lastUsedTime = stats->totalTicks;
                //PrintTLB();
 
  }
@@ -260,98 +345,330 @@ void Machine::WriteRegister(int num, int value)
  void Machine::FIFOSwapTLB(int badVAddr)
  {
                unsigned int vpn = (unsigned) badVAddr / PageSize;    // 虚拟页号
-               int minTime = tlb[0].inTLBTime;
-               TranslationEntry *entry = &tlb[0];          //  将要替换掉的页表项
-               // 遍历TLB找到一个vaild为false，或者最先进入TLB的表项
-               for (int i = 0; i < TLBSize; ++i) {
-                      if (tlb[i].valid == FALSE) {
-                              entry = &tlb[i];
+               TranslationEntry *set = TLBSet(vpn);
+               TranslationEntry *entry = &set[0];          //  将要替换掉的页表项
+               // 在vpn所在的组中找到一个vaild为false，或者最先进入TLB的表项
+               for (int i = 0; i < TLBWays; ++i) {
+                      if (set[i].valid == FALSE) {
+                              entry = &set[i];
                               break;
                       }
-                      else if (tlb[i].inTLBTime < minTime) {
-                              minTime = tlb[i].inTLBTime;
-                              entry = &tlb[i];
-                      }
+                      else if (set[i].inTLBTime < entry->inTLBTime)
+                              entry = &set[i];
                }
                // 将TLB中将要替换下去的页表项的内容写回页表
-                if (entry->valid)
-                      pageTable[entry->virtualPage] = *entry;               
-               if (pageTable[vpn].valid)
-                      *entry = pageTable[vpn];                        
-               else {
+               if (entry->valid)
+                      TLBWriteBack(entry);
+               TranslationEntry *pte = pageTable->Lookup(vpn);
+               if (pte == NULL || !pte->valid) {
                       AllocatePhysPage(badVAddr);
-                      *entry = pageTable[vpn];
-               } 
+                      pte = pageTable->Lookup(vpn);
+               }
+               *entry = *pte;
+               entry->asid = currentASID;
                entry->inTLBTime = stats->totalTicks;
  }
 
 void Machine::ClearTLB() {
+        if (tlb == NULL)
+             return;
         for (int i = 0; i < TLBSize; ++i) {
              if (tlb[i].valid) {
-                 pageTable[tlb[i].virtualPage] = tlb[i];
+                 TLBWriteBack(&tlb[i]);
                  tlb[i].valid = FALSE;
              }
         }
 }
+
+//----------------------------------------------------------------------
+// Machine::FlushASID
+//  Invalidate every TLB entry belonging to address space "asid".
+//----------------------------------------------------------------------
+
+void Machine::FlushASID(int asid) {
+        if (tlb == NULL)
+             return;
+        for (int i = 0; i < TLBSize; ++i) {
+             if (tlb[i].valid && tlb[i].asid == asid) {
+                 TLBWriteBack(&tlb[i]);
+                 tlb[i].valid = FALSE;
+             }
+        }
+}
+
+//----------------------------------------------------------------------
+// Machine::AllocateASID
+//  Give a new address space a tag for its TLB entries, and start 
+//  counting its TLB hits and misses.
+//----------------------------------------------------------------------
+
+int Machine::AllocateASID(AddrSpace *space)
+{
+        int asid = asidMap->Find();
+
+        ASSERT(asid != -1);         // one per thread at most
+        asidSpace[asid] = space;
+        tlbHits[asid] = tlbMisses[asid] = 0;
+        return asid;
+}
+
+//----------------------------------------------------------------------
+// Machine::FreeASID
+//  An address space is going away: drop its TLB entries, so that 
+//  the tag can be reused, and keep its counts in the totals.
+//----------------------------------------------------------------------
+
+void Machine::FreeASID(int asid)
+{
+        FlushASID(asid);
+        asidSpace[asid] = NULL;
+        retiredHits += tlbHits[asid];
+        retiredMisses += tlbMisses[asid];
+        tlbHits[asid] = tlbMisses[asid] = 0;
+        asidMap->Clear(asid);
+}
+
  void Machine::PrintTLB() {
                printf("Now Total Ticks : %d\n", stats->totalTicks);
-               printf("TLB : \n");
-               printf("VPN  PPN   Valid  ReadOnly  Use  Dirty   InTLBTime LastUsedTime\n");
+               printf("TLB : %d sets x %d ways\n", tlbSets, TLBWays);
+               printf("ASID VPN  PPN   Valid  ReadOnly  Use  Dirty   InTLBTime LastUsedTime\n");
                for (int i = 0; i < TLBSize; ++i) {
                      tlb[i].Print();
                }
  }
 
+//----------------------------------------------------------------------
+// Machine::PrintTLBStats
+//  Print TLB hits and misses for each live address space, and the 
+//  totals including spaces that have already exited.
+//----------------------------------------------------------------------
+
+ void Machine::PrintTLBStats() {
+               int hits = retiredHits, misses = retiredMisses;
+
+               for (int i = 0; i < NumASIDs; ++i) {
+                     if (asidSpace[i] == NULL)
+                            continue;
+                     printf("TLB ASID %d:  Hit %d, Miss %d\n", i, 
+                            tlbHits[i], tlbMisses[i]);
+                     hits += tlbHits[i];
+                     misses += tlbMisses[i];
+               }
+               printf("TLB:  Hit %d, Miss %d\n", hits, misses);
+ }
+
  void Machine::AllocatePhysPage(int badVA)
  {
                unsigned int vpn = (unsigned) badVA / PageSize;    // 虚拟页号
-               int virAddr = vpn * PageSize;
-               pageTable[vpn].virtualPage = vpn;
-            
-               int ppn = mBitMap->Find();
-             
-               if (ppn != -1)   {    // 有空闲块
-                      pageTable[vpn].physicalPage = ppn;
-                      pageTable[vpn].valid = TRUE;
-               }  else  {               // 需要完成物理页的置换
-                      ppn = LRUSwapPages();
-                      pageTable[vpn].physicalPage = ppn;
-                      pageTable[vpn].valid = TRUE;
-                      pageTable[vpn].dirty = FALSE;
+               AddrSpace *space = currentThread->space;
+               int stride, count;
+
+               stats->numPageFaults++;
+               currentThread->usage.pageFaults++;
+               PageIn(space, vpn);
+
+               // 顺序或固定步长的缺页，预取后面的页
+               count = space->NoteFault(vpn, &stride);
+               if (count > 0) {
+                      int n = Prefetch(space, vpn, stride, count);
+                      space->lastFaultPage = vpn + n * stride;
                }
+ }
+
+//----------------------------------------------------------------------
+// Machine::PageIn
+//  Make virtual page "vpn" of "space" resident, and fill in its page 
+//  table entry (creating the entry on first touch).
+//
+//  Pages that hold nothing but program code are shared: if another 
+//  address space running the same executable already has the page in 
+//  memory, just map that frame read-only.  Otherwise load the page 
+//  from the address space's swap file ("vaSpace"), or zero fill it if 
+//  it was never saved, and, for a code page, enter the frame into the 
+//  page cache so that others can find it.
+//----------------------------------------------------------------------
 
-               physPageTable[ppn].vaPageNum = vpn;
-               
-               currentThread->space->vaSpace->ReadAt(&(machine->mainMemory[ppn*PageSize]), 
-                PageSize, virAddr);
-               
-               physPageTable[ppn].valid =TRUE;
+ void Machine::PageIn(AddrSpace *space, int vpn)
+ {
+               TranslationEntry *entry = space->pageTable->Create(vpn);
+               bool shared = space->IsSharedCode(vpn);
+               int ppn = -1;
+
+               if (shared)
+                      ppn = pageCache->Attach(space->codeKey, vpn);
+               if (ppn == -1) {
+                      ppn = AllocateFrame(space);
+                      space->ReadIn(entry, ppn);
+                      if (shared)
+                             pageCache->Insert(space->codeKey, vpn, ppn);
+               }
+               DEBUG('a', "Page in vpn %d to frame %d%s\n", vpn, ppn,
+                      shared ? " (shared)" : "");
+               MapPage(space, entry, ppn, shared);
+ }
+
+//----------------------------------------------------------------------
+// Machine::MapPage
+//  Record that frame "ppn" now holds the page described by "entry", 
+//  and make the translation valid.
+//----------------------------------------------------------------------
+
+ void Machine::MapPage(AddrSpace *space, TranslationEntry *entry, int ppn,
+                       bool shared)
+ {
+               physPageTable[ppn].vaPageNum = entry->virtualPage;
+               physPageTable[ppn].valid = TRUE;
                physPageTable[ppn].dirty = FALSE;
-               physPageTable[ppn].heldThreadID = currentThread->GetThreadID();
+               physPageTable[ppn].lastUsedTime = stats->totalTicks;
+               physPageTable[ppn].space = shared ? NULL : space;
+
+               space->usage.residentPages++;
+               space->usage.maxResident = max(space->usage.maxResident,
+                      space->usage.residentPages);
+               entry->physicalPage = ppn;
+               entry->valid = TRUE;
+               entry->use = FALSE;
+               entry->dirty = FALSE;
+               entry->readOnly = shared;
+ }
+
+//----------------------------------------------------------------------
+// Machine::Prefetch
+//  Read ahead up to "count" pages of "space" after a fault on "vpn", 
+//  following the fault pattern: pages vpn + stride, vpn + 2*stride, ...
+//
+//  Prefetching only uses free frames (keeping PrefetchReserve of them 
+//  for demand faults), and stops at the space's resident limit; it 
+//  never evicts.  Pages whose swap file copies 
+//  are consecutive are read with a single ReadAt.
+//
+//  Returns the number of pages considered, so that the caller knows 
+//  where the next demand fault of the pattern is expected.
+//----------------------------------------------------------------------
+
+ int Machine::Prefetch(AddrSpace *space, int vpn, int stride, int count)
+ {
+               TranslationEntry *run[MaxPrefetchPages];
+               int runLen = 0;
+               int k;
+
+               ASSERT(count <= MaxPrefetchPages);
+               for (k = 1; k <= count; k++) {
+                      int page = vpn + k * stride;
+                      if (!space->IsValidPage(page) 
+                             || mBitMap->NumClear() - runLen <= PrefetchReserve
+                             || space->AtResidentLimit(runLen))
+                             break;
+                      TranslationEntry *entry = space->pageTable->Create(page);
+                      if (entry->valid)
+                             continue;
+                      stats->numPrefetched++;
+                      if (space->IsSharedCode(page) || entry->backingPage == -1) {
+                             PageIn(space, page);      // 共享或零填充，无需批量读
+                             continue;
+                      }
+                      if (runLen > 0 && entry->backingPage 
+                                    != run[runLen - 1]->backingPage + 1) {
+                             ReadRun(space, run, runLen);
+                             runLen = 0;
+                      }
+                      run[runLen++] = entry;
+               }
+               if (runLen > 0)
+                      ReadRun(space, run, runLen);
+               return k - 1;
  }
 
- int Machine::LRUSwapPages()
+//----------------------------------------------------------------------
+// Machine::ReadRun
+//  Bring in "n" pages of "space" whose swap file copies are 
+//  consecutive, with one read, into free frames.
+//----------------------------------------------------------------------
+
+ void Machine::ReadRun(AddrSpace *space, TranslationEntry **run, int n)
  {
-               int minTime = physPageTable[0].lastUsedTime;
-               int swapPageNum= 0;
+               char *buffer = new char[n * PageSize];
+
+               bzero(buffer, n * PageSize);
+               space->vaSpace->ReadAt(buffer, n * PageSize, 
+                      run[0]->backingPage * PageSize);
+               for (int i = 0; i < n; i++) {
+                      int ppn = mBitMap->Find();
+                      ASSERT(ppn != -1);
+                      bcopy(&buffer[i * PageSize], &mainMemory[ppn * PageSize], 
+                             PageSize);
+                      DEBUG('a', "Prefetch vpn %d to frame %d\n", 
+                             run[i]->virtualPage, ppn);
+                      MapPage(space, run[i], ppn, FALSE);
+               }
+               delete [] buffer;
+ }
+
+//----------------------------------------------------------------------
+// Machine::AllocateFrame
+//  Return a physical page for a page of "space", evicting one if 
+//  memory is full.  A space at its resident limit (cf. SetLimit) 
+//  replaces one of its own pages instead, so that it cannot crowd 
+//  the others out of memory.
+//----------------------------------------------------------------------
+
+ int Machine::AllocateFrame(AddrSpace *space)
+ {
+               int ppn = -1;
+
+               if (space->AtResidentLimit(0))
+                      ppn = LRUSwapPages(space);
+               if (ppn == -1)
+                      ppn = mBitMap->Find();
+               if (ppn == -1)          // 需要完成物理页的置换
+                      ppn = LRUSwapPages(NULL);
+               return ppn;
+ }
+
+//----------------------------------------------------------------------
+// Machine::LRUSwapPages
+//  Evict the least recently used frame -- of those holding private 
+//  pages of "only", if it is not NULL -- and return it, or -1 if 
+//  "only" has no page to give up.
+//----------------------------------------------------------------------
+
+ int Machine::LRUSwapPages(AddrSpace *only)
+ {
+               int minTime = 0;
+               int swapPageNum = -1;
                for (int i = 0; i < NumPhysPages; ++i) {
-                        if (physPageTable[i].lastUsedTime < minTime) {
+                        if (only != NULL && (physPageTable[i].space != only
+                                             || !physPageTable[i].valid))
+                                continue;
+                        if (swapPageNum == -1 
+                                || physPageTable[i].lastUsedTime < minTime) {
                                 minTime = physPageTable[i].lastUsedTime;
                                 swapPageNum = i;
                       }
                }
-               printf("Swap Page %d\n", swapPageNum);
-               Thread* tempThread = threadsInfo[physPageTable[swapPageNum].heldThreadID];
-               if (tempThread != NULL && physPageTable[swapPageNum].valid 
-               && physPageTable[swapPageNum].dirty) {         // 写回文件
-                      
-                      tempThread->space->vaSpace->WriteAt(&(machine->mainMemory[swapPageNum * PageSize]), 
-                        PageSize,  physPageTable[swapPageNum].vaPageNum * PageSize);
-               }
+               if (swapPageNum == -1)
+                      return -1;
+               DEBUG('a', "Swap Page %d\n", swapPageNum);
                int swapVpn = physPageTable[swapPageNum].vaPageNum;
-               if (tempThread != NULL) {
-               tempThread->space->pageTable[swapVpn].valid = FALSE;
-               tempThread->space->pageTable[swapVpn].dirty = FALSE;
-             }
+               AddrSpace *owner = physPageTable[swapPageNum].space;
+               if (pageCache->IsCached(swapPageNum)) {
+                      // 共享代码页只读，无需写回；取消所有地址空间中的映射
+                      pageCache->Evict(swapPageNum);
+               } else if (owner != NULL && physPageTable[swapPageNum].valid) {
+                      TranslationEntry *pte = owner->pageTable->Lookup(swapVpn);
+                      if (physPageTable[swapPageNum].dirty)     // 写回文件
+                             owner->WriteBack(pte, swapPageNum);
+                      pte->valid = FALSE;
+                      pte->dirty = FALSE;
+                      owner->usage.residentPages--;
+               }
+               // TLB中指向该物理页的表项也要作废，否则换出时会被写回页表
+               if (tlb != NULL)
+                      for (int i = 0; i < TLBSize; ++i)
+                             if (tlb[i].valid && tlb[i].physicalPage == swapPageNum)
+                                    tlb[i].valid = FALSE;
+               physPageTable[swapPageNum].valid = FALSE;
+               physPageTable[swapPageNum].dirty = FALSE;
+               physPageTable[swapPageNum].space = NULL;
                return swapPageNum;
- }
\ No newline at end of file
+ }
@@ -26,16 +26,35 @@
 #include "translate.h"
 #include "disk.h"
 #include "bitmap.h"
+#include "pagetable.h"
 
-// Definitions related to the size, and format of user memory
+class AddrSpace;
 
-#define PageSize    SectorSize  // set the page size equal to
+// Definitions related to the size, and format of user memory.
+// These are set at start-up (see Initialize in system.cc, flags
+// -ps, -np and -tlb, or a -cf config file), so that memory and TLB
+// sizes can be varied without recompiling.  They must not change
+// once "machine" has been created.
+
+#define DefaultPageSize     SectorSize  // set the page size equal to
                     // the disk sector size, for
                     // simplicity
+#define DefaultNumPhysPages 32
+#define DefaultTLBSize      4   // if there is a TLB, make it small
+#define DefaultTLBWays      4   // entries per TLB set
+
+extern int PageSize;        // bytes per page (a multiple of 4)
+extern int NumPhysPages;    // number of frames in "mainMemory"
+extern int TLBSize;         // number of TLB entries
+extern int TLBWays;         // associativity of the TLB; TLBSize 
+                            // must be a multiple of it
+
+#define MaxPrefetchPages    8   // largest readahead window
+#define PrefetchReserve     2   // free frames readahead leaves alone
 
-#define NumPhysPages    32
+#define NumASIDs    128     // address space identifiers tagging
+                            // TLB entries (one per live AddrSpace)
 #define MemorySize  (NumPhysPages * PageSize)
-#define TLBSize     4       // if there is a TLB, make it small
 
 enum ExceptionType { NoException,           // Everything ok!
              SyscallException,      // A program executed a system call.
@@ -98,7 +117,8 @@ class PhysicalPage {
         bool valid;
         bool dirty;
         int lastUsedTime; 
-        int heldThreadID;
+        AddrSpace *space;       // 拥有该物理页的地址空间；
+                                // 共享代码页为NULL（由pageCache管理）
 
 };
 // The following class defines the simulated host workstation hardware, as 
@@ -161,10 +181,39 @@ class Machine {
     void LRUSwapTLB(int badVAddr);   
     void FIFOSwapTLB(int badVAddr);
     void PrintTLB();                         // 打印TLB信息
+    void PrintTLBStats();                    // 打印每个ASID的命中率
     void ClearTLB();
+    void FlushASID(int asid);   // drop the TLB entries of one space
+    TranslationEntry *TLBLookup(int vpn);
+                // Probe the set "vpn" maps to for an entry 
+                // of the running address space
+    TranslationEntry *TLBSet(int vpn);
+                // First entry of the set "vpn" maps to
+    void TLBWriteBack(TranslationEntry *entry);
+                // Copy use/dirty bits back to the owner's 
+                // page table
+
+    int AllocateASID(AddrSpace *space); // Tag for a new address space
+    void FreeASID(int asid);
     void AllocatePhysPage(int badVA);    // 分配物理页
-
-    int LRUSwapPages();
+    void PageIn(AddrSpace *space, int vpn);
+                // Bring virtual page "vpn" of "space" into 
+                // memory; code pages are shared through 
+                // the page cache
+
+    void MapPage(AddrSpace *space, TranslationEntry *entry, int ppn,
+                 bool shared);  // Point "entry" at frame "ppn"
+    int Prefetch(AddrSpace *space, int vpn, int stride, int count);
+                // Read ahead along a fault pattern
+    void ReadRun(AddrSpace *space, TranslationEntry **run, int n);
+                // Batched read of pages with consecutive 
+                // swap file copies
+
+    int AllocateFrame(AddrSpace *space);
+                // 取一个空闲物理页，没有则置换
+    int LRUSwapPages(AddrSpace *only);
+                // Evict the least recently used frame (of 
+                // "only", if not NULL); -1 if none
     
 // Data structures -- all of these are accessible to Nachos kernel code.
 // "public" for convenience.
@@ -199,12 +248,22 @@ class Machine {
     TranslationEntry *tlb;      // this pointer should be considered 
                     // "read-only" to Nachos kernel code
 
-    TranslationEntry *pageTable;  //页表
-    unsigned int pageTableSize;
+    PageTable *pageTable;  //页表（线性、两级或哈希）
+
+    int currentASID;    // tag of the running address space
+    int llAddr;         // address of the last LL instruction
+    bool llBit;         // does the link still hold?  Cleared on 
+                        // every trap and context switch
+    int tlbSets;        // TLBSize / TLBWays
 
-    int hitTime;   //Hit的次数
-    int missTime;  //Miss的次数
+    int *tlbHits;       // TLB hits, per ASID
+    int *tlbMisses;     // TLB misses, per ASID
+    int retiredHits;    // counts of ASIDs that have been freed
+    int retiredMisses;
   private:
+    BitMap *asidMap;        // which ASIDs are in use
+    AddrSpace **asidSpace;  // owner of each ASID, for write-back
+
     bool singleStep;        // drop back into the debugger after each
                 // simulated instruction
     int runUntilTime;       // drop back into the debugger when simulated
@@ -216,6 +275,10 @@ extern void ExceptionHandler(ExceptionType which);
                 // Entry point into Nachos for handling
                 // user system calls and exceptions
                 // Defined in exception.cc
+extern void EnforceCpuLimit();
+                // Called when a user program is preempted:
+                // stop it if it is over its CPU limit
+                // (cf. SetLimit).  Also in exception.cc
 
 
 // Routines for converting Words and Short Words to and from the
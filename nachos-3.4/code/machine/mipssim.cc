@@ -322,6 +322,23 @@ Machine::OneInstruction(Instruction *instr)
 	nextLoadReg = instr->rt;
 	break;
       	
+      case OP_LL:
+	// Load linked: an ordinary LW, which also remembers the address.
+	// The link is broken by any trap or context switch, so SC only
+	// succeeds if nothing can have run in between (cf. llBit).
+	tmp = registers[instr->rs] + instr->extra;
+	if (tmp & 0x3) {
+	    RaiseException(AddressErrorException, tmp);
+	    return;
+	}
+	if (!machine->ReadMem(tmp, 4, &value))
+	    return;
+	machine->llAddr = tmp;
+	machine->llBit = TRUE;
+	nextLoadReg = instr->rt;
+	nextLoadValue = value;
+	break;
+
       case OP_LWR:
 	tmp = registers[instr->rs] + instr->extra;
 
@@ -545,6 +562,24 @@ Machine::OneInstruction(Instruction *instr)
 	    return;
 	break;
     	
+      case OP_SC:
+	// Store conditional: store only if the link set by LL still
+	// holds, and leave 1 in rt if the store was done, 0 if not.
+	tmp = registers[instr->rs] + instr->extra;
+	if (tmp & 0x3) {
+	    RaiseException(AddressErrorException, tmp);
+	    return;
+	}
+	if (machine->llBit && machine->llAddr == tmp) {
+	    if (!machine->WriteMem(tmp, 4, registers[instr->rt]))
+		return;
+	    nextLoadValue = 1;
+	} else
+	    nextLoadValue = 0;
+	machine->llBit = FALSE;
+	nextLoadReg = instr->rt;
+	break;
+
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
 	return; 
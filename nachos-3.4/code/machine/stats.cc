@@ -20,8 +20,10 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPrefetched = 0;
 }
 
 //----------------------------------------------------------------------
@@ -36,9 +38,66 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    if (numCacheHits + numCacheMisses > 0)
+	printf("Buffer cache: hits %d, misses %d, hit ratio %.2f\n", 
+	    numCacheHits, numCacheMisses, 
+	    (double) numCacheHits / (numCacheHits + numCacheMisses));
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    printf("Paging: faults %d, prefetched %d\n", numPageFaults, 
+	numPrefetched);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
+
+//----------------------------------------------------------------------
+// Usage::Usage
+// 	Initialize the counts to zero, for a new thread or process.
+//----------------------------------------------------------------------
+
+Usage::Usage()
+{
+    userTicks = systemTicks = 0;
+    pageFaults = tlbMisses = 0;
+    diskReads = diskWrites = 0;
+    residentPages = maxResident = workingSet = 0;
+    for (int i = 0; i < NumSyscallCodes; i++)
+	syscalls[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// Usage::Add
+// 	Add the counts of "other" to ours, e.g. those of a thread to its
+//	process.  The resident and working sets are the process's own,
+//	and are kept.
+//----------------------------------------------------------------------
+
+void
+Usage::Add(Usage *other)
+{
+    userTicks += other->userTicks;
+    systemTicks += other->systemTicks;
+    pageFaults += other->pageFaults;
+    tlbMisses += other->tlbMisses;
+    diskReads += other->diskReads;
+    diskWrites += other->diskWrites;
+    for (int i = 0; i < NumSyscallCodes; i++)
+	syscalls[i] += other->syscalls[i];
+}
+
+//----------------------------------------------------------------------
+// Usage::Print
+// 	Print the counts as one line of a "ps" listing, after "label".
+//----------------------------------------------------------------------
+
+void
+Usage::Print(char *label)
+{
+    int calls = 0;
+
+    for (int i = 0; i < NumSyscallCodes; i++)
+	calls += syscalls[i];
+    printf("%-20s %7d %7d %6d %6d %6d %6d %5d %5d %5d %6d\n", label, 
+	userTicks, systemTicks, pageFaults, tlbMisses, diskReads, diskWrites, 
+	residentPages, maxResident, workingSet, calls);
+}
@@ -30,9 +30,13 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numCacheHits;		// sector reads/writes found in the 
+				// buffer cache
+    int numCacheMisses;		// ... and not found there
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPrefetched;		// number of pages read ahead of a fault
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
@@ -41,6 +45,35 @@ class Statistics {
     void Print();		// print collected statistics
 };
 
+#define NumSyscallCodes	32	// system call codes counted by Usage;
+				// the same as in syscall.h
+
+// The resources used by one thread, or by one process -- the threads
+// of an address space, both running and exited -- so that the cost of
+// a multiprogrammed run can be split among the programs.  Every field
+// is an int, in the order of ProcessUsage in syscall.h, as which the
+// GetUsage system call copies it out.
+
+class Usage {
+  public:
+    int userTicks;		// user instructions executed
+    int systemTicks;		// time in the kernel
+    int pageFaults;		// pages faulted in
+    int tlbMisses;		// TLB misses
+    int diskReads;		// sectors read from the disk
+    int diskWrites;		// sectors written to the disk
+    int residentPages;		// (processes only) frames mapped now
+    int maxResident;		// ... and the most there have been
+    int workingSet;		// (processes only) resident pages used
+				// in the last WorkingSetWindow ticks
+    int syscalls[NumSyscallCodes];	// system calls made, by code
+
+    Usage();			// initialize everything to zero
+
+    void Add(Usage *other);	// add in the counts of "other"
+    void Print(char *label);	// print on one line, after "label"
+};
+
 // Constants used to reflect the relative time an operation would
 // take in a real system.  A "tick" is a just a unit of time -- if you 
 // like, a microsecond.
@@ -35,6 +35,8 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #ifdef HOST_i386
 #include <unistd.h>
 #include <sys/time.h>
@@ -214,6 +216,41 @@ WriteFile(int fd, char *buffer, int nBytes)
     ASSERT(retVal == nBytes);
 }
 
+//----------------------------------------------------------------------
+// ReadVector/WriteVector
+// 	Read or write "count" buffers of "nBytes" each, to or from
+//	consecutive bytes of a file starting at "offset", with a single
+//	system call.  Abort if the transfer is short.
+//----------------------------------------------------------------------
+
+void
+ReadVector(int fd, int offset, char **buffers, int count, int nBytes)
+{
+    struct iovec *iov = new struct iovec[count];
+
+    for (int i = 0; i < count; i++) {
+	iov[i].iov_base = buffers[i];
+	iov[i].iov_len = nBytes;
+    }
+    int retVal = preadv(fd, iov, count, offset);
+    ASSERT(retVal == count * nBytes);
+    delete [] iov;
+}
+
+void
+WriteVector(int fd, int offset, char **buffers, int count, int nBytes)
+{
+    struct iovec *iov = new struct iovec[count];
+
+    for (int i = 0; i < count; i++) {
+	iov[i].iov_base = buffers[i];
+	iov[i].iov_len = nBytes;
+    }
+    int retVal = pwritev(fd, iov, count, offset);
+    ASSERT(retVal == count * nBytes);
+    delete [] iov;
+}
+
 //----------------------------------------------------------------------
 // Lseek
 // 	Change the location within an open file.  Abort on error.
@@ -265,6 +302,99 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// FileIdentity
+// 	Return a number identifying the UNIX file behind "fd" (its inode 
+//	number), so that two opens of the same file can be recognized.
+//----------------------------------------------------------------------
+
+int 
+FileIdentity(int fd)
+{
+    struct stat buf;
+    int retVal = fstat(fd, &buf);
+    ASSERT(retVal >= 0);
+    return (int) buf.st_ino;
+}
+
+//----------------------------------------------------------------------
+// FileVersion
+// 	Return a number that changes whenever the UNIX file behind "fd"
+//	is written: its modification time, to the nanosecond.
+//----------------------------------------------------------------------
+
+int 
+FileVersion(int fd)
+{
+    struct stat buf;
+    int retVal = fstat(fd, &buf);
+    ASSERT(retVal >= 0);
+    return (int) ((unsigned) buf.st_mtime * 1000003u
+				+ (unsigned) buf.st_mtim.tv_nsec);
+}
+
+//----------------------------------------------------------------------
+// ExtendFile
+// 	Make the UNIX file behind "fd" at least "nBytes" long, by
+//	padding it with zeroes.  Return its length before.  Abort on
+//	error.
+//----------------------------------------------------------------------
+
+int 
+ExtendFile(int fd, int nBytes)
+{
+    struct stat buf;
+    int retVal = fstat(fd, &buf);
+    ASSERT(retVal >= 0);
+    if (buf.st_size < nBytes) {
+	retVal = ftruncate(fd, nBytes);
+	ASSERT(retVal >= 0);
+    }
+    return (int) buf.st_size;
+}
+
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "nBytes" of an open file into memory, shared, so
+//	that stores into the mapping change the file.  Abort on error.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int nBytes)
+{
+    void *base = mmap(NULL, nBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    ASSERT(base != MAP_FAILED);
+    return (char *) base;
+}
+
+//----------------------------------------------------------------------
+// SyncMapping
+// 	Force bytes [offset, offset + nBytes) of a mapping from MapFile
+//	out to the file.  msync works on whole pages, so round the start
+//	down to a page boundary.
+//----------------------------------------------------------------------
+
+void
+SyncMapping(char *base, int offset, int nBytes)
+{
+    int start = offset - (offset % getpagesize());
+    int retVal = msync(base + start, nBytes + offset - start, MS_SYNC);
+
+    ASSERT(retVal == 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Undo MapFile.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *base, int nBytes)
+{
+    munmap(base, nBytes);
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now, 
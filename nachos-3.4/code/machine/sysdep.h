@@ -25,9 +25,19 @@ extern void Read(int fd, char *buffer, int nBytes);
 extern int ReadPartial(int fd, char *buffer, int nBytes);
 extern void WriteFile(int fd, char *buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
+extern void ReadVector(int fd, int offset, char **buffers, int count,
+								int nBytes);
+extern void WriteVector(int fd, int offset, char **buffers, int count,
+								int nBytes);
 extern int Tell(int fd);
 extern void Close(int fd);
 extern bool Unlink(char *name);
+extern int FileIdentity(int fd);
+extern int FileVersion(int fd);
+extern int ExtendFile(int fd, int nBytes);
+extern char *MapFile(int fd, int nBytes);
+extern void SyncMapping(char *base, int offset, int nBytes);
+extern void UnmapFile(char *base, int nBytes);
 
 // Interprocess communication operations, for simulating the network
 extern int OpenSocket();
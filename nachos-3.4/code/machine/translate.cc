@@ -226,31 +226,25 @@
       offset = (unsigned) virtAddr % PageSize;
       printf("VPN %d\n", vpn);
       //printf("VPN : %d\n", vpn);
-      if (tlb == NULL) {    // => page table => vpn is index into table
-        if (vpn >= pageTableSize) {
-          DEBUG('a', "virtual page # %d too large for page table size %d!\n", virtAddr, pageTableSize);
-          return AddressErrorException;
-    } else if (!pageTable[vpn].valid) {
-          DEBUG('a', "virtual page # %d too large for page table size %d!\n", virtAddr, pageTableSize);
+      if (tlb == NULL) {    // => walk the page table
+        entry = pageTable->Lookup(vpn);
+        if (entry == NULL || !entry->valid) {
+          DEBUG('a', "virtual page # %d not mapped!\n", vpn);
           return PageFaultException;
     }
-    entry = &pageTable[vpn];
   } else {
-    for (entry = NULL, i = 0; i < TLBSize; i++)
-    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
-        entry = &tlb[i];      // FOUND!
-       break;
-  }
+    entry = TLBLookup(vpn);
   if (entry == NULL) {        // not found
 
     DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
-    missTime++;
+    tlbMisses[currentASID]++;
+    currentThread->usage.tlbMisses++;
     return PageFaultException;    // really, this is a TLB fault,
               // the page may be in memory,
               // but not in the TLB
             
     }
-    hitTime++;
+    tlbHits[currentASID]++;
     entry->lastUsedTime=stats->totalTicks;
     physPageTable[entry->physicalPage].lastUsedTime = stats->totalTicks;
 
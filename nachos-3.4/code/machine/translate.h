@@ -40,11 +40,14 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
+    int asid;           // TLB only: address space the entry belongs to
+    int backingPage;    // page of the swap file holding this page, or
+                        // -1 if it was never written (zero fill)
     int inTLBTime;      // 用于FIFO的置换策略
     int lastUsedTime;      // 用于TLB的置换策略
     
     void Print() {
-          printf("%d    %d  ", virtualPage, physicalPage);
+          printf("%d    %d    %d  ", asid, virtualPage, physicalPage);
           if (valid) printf("  true  ");
           else printf("  false  ");
           if (readOnly) printf(" true ");
@@ -112,6 +112,9 @@ class PostOffice {
 				// machine.  The fromBox in the MailHeader is 
 				// the return box for ack's.
     
+    int NumBoxes() { return numBoxes; }
+				// Mail boxes are numbered from 0
+
     void Receive(int box, PacketHeader *pktHdr, 
 		MailHeader *mailHdr, char *data);
     				// Retrieve a message from "box".  Wait if
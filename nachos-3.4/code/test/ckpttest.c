@@ -0,0 +1,79 @@
+/* ckpttest.c
+ *	Test Checkpoint, and restoring a program with "nachos -rx".
+ *
+ *	Build up some state -- global data, a heap grown with Sbrk, and a
+ *	local on the stack -- and save the program.  The first run then 
+ *	wrecks that state and exits; running the saved program again 
+ *	("nachos -rx ckpttest.img") must find it all as it was saved.  A 
+ *	program with a file open cannot be saved.  Exit 0 if all is well.
+ */
+
+#include "syscall.h"
+
+#define Size	200
+
+int data[Size];
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+void
+Fail(char *what)
+{
+    Say("ckpttest: FAIL ");
+    Say(what);
+    Say("\n");
+    Exit(1);
+}
+
+int
+main()
+{
+    char *heap;
+    int local = 12345;
+    OpenFileId fd;
+    int i, addr, result;
+
+    for (i = 0; i < Size; i++)
+	data[i] = i * i;
+    if ((addr = Sbrk(Size)) == -1)
+	Fail("Sbrk");
+    heap = (char *) addr;
+    for (i = 0; i < Size; i++)
+	heap[i] = 'a' + i % 26;
+
+    if (Create("ckpttest.dat") != 0 || (fd = Open("ckpttest.dat")) < 0)
+	Fail("Create or Open");
+    if (Checkpoint("ckpttest.img") != -1)
+	Fail("Checkpoint with a file open");
+    Close(fd);
+
+    result = Checkpoint("ckpttest.img");
+    if (result == 0) {				/* saved; wreck it all */
+	for (i = 0; i < Size; i++)
+	    data[i] = heap[i] = 0;
+	local = 0;
+	Say("ckpttest: saved; run it again with -rx ckpttest.img\n");
+	Exit(0);
+    }
+    if (result != 1)
+	Fail("Checkpoint");
+
+    for (i = 0; i < Size; i++)			/* restored */
+	if (data[i] != i * i)
+	    Fail("global data");
+    for (i = 0; i < Size; i++)
+	if (heap[i] != 'a' + i % 26)
+	    Fail("heap");
+    if (local != 12345)
+	Fail("stack");
+    Say("ckpttest: restored ok\n");
+    Exit(0);
+}
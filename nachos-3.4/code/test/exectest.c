@@ -0,0 +1,55 @@
+/* exectest.c
+ *	Test Exec and Join.
+ *
+ *	Run "array" and "sort" (cf. array.c, sort.c) side by side, and 
+ *	check the status each exits with; also check that a missing 
+ *	executable, and a SpaceId we did not Exec, are refused.  Run from 
+ *	the directory above test, like the other test programs; exit 0 if 
+ *	all is well.
+ */
+
+#include "syscall.h"
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+void
+Fail(char *what)
+{
+    Say("exectest: FAIL ");
+    Say(what);
+    Say("\n");
+    Exit(1);
+}
+
+int
+main()
+{
+    SpaceId array, sort;
+
+    if ((array = Exec("../test/array")) < 0)
+	Fail("Exec array");
+    if ((sort = Exec("../test/sort")) < 0)
+	Fail("Exec sort");
+    if (Join(sort) != 0)		/* sort exits with its smallest key */
+	Fail("status of sort");
+    if (Join(array) != 100)		/* array exits with A[10][10] */
+	Fail("status of array");
+    if (Join(array) != -1)
+	Fail("second Join");
+
+    if (Exec("../test/nonexistent") != -1)
+	Fail("Exec of a missing file");
+    if (Join(12345) != -1)
+	Fail("Join of a bad SpaceId");
+
+    Say("exectest: ok\n");
+    Exit(0);
+}
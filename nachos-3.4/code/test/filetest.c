@@ -0,0 +1,74 @@
+/* filetest.c
+ *	Test the file system calls: Create, Open, Write, Read and Close.
+ *
+ *	Write a pattern to a new file, read it back through a second 
+ *	descriptor, and check that reads stop at the end of the file and 
+ *	that bad names and descriptors are refused.  Exit 0 if all is 
+ *	well.
+ */
+
+#include "syscall.h"
+
+#define Size	300		/* more than two sectors */
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+void
+Fail(char *what)
+{
+    Say("filetest: FAIL ");
+    Say(what);
+    Say("\n");
+    Exit(1);
+}
+
+int
+main()
+{
+    char out[Size], in[Size];
+    OpenFileId fd;
+    int i, n;
+
+    for (i = 0; i < Size; i++)
+	out[i] = 'a' + i % 26;
+
+    if (Create("filetest.dat") != 0)
+	Fail("Create");
+    if ((fd = Open("filetest.dat")) < 0)
+	Fail("Open");
+    if (Write(out, 100, fd) != 100 || Write(&out[100], Size - 100, fd) 
+		!= Size - 100)
+	Fail("Write");
+    Close(fd);
+
+    if ((fd = Open("filetest.dat")) < 0)
+	Fail("Open again");
+    for (i = 0; i < Size; i++)
+	in[i] = 0;
+    if ((n = Read(in, 50, fd)) != 50)
+	Fail("Read");
+    if ((n = Read(&in[50], Size, fd)) != Size - 50)
+	Fail("Read to the end");
+    if (Read(in, 1, fd) != 0)
+	Fail("Read past the end");
+    for (i = 0; i < Size; i++)
+	if (in[i] != out[i])
+	    Fail("data read back");
+    Close(fd);
+
+    if (Open("no such file") != -1)
+	Fail("Open of a missing file");
+    if (Read(in, 1, fd) != -1 || Write(out, 1, 99) != -1)
+	Fail("closed or bad descriptor");
+
+    Say("filetest: ok\n");
+    Exit(0);
+}
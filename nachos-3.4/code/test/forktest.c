@@ -0,0 +1,84 @@
+/* forktest.c
+ *	Test Fork: threads sharing one address space.
+ *
+ *	Fork NumThreads threads; each sums a slice of an array that the 
+ *	main thread filled in, on its own stack, and stores its result.  
+ *	The main thread yields until they are all done, and checks the 
+ *	total.  Exit 0 if all is well.
+ */
+
+#include "syscall.h"
+
+#define NumThreads	3
+#define Slice		20
+
+int data[NumThreads * Slice];
+int sums[NumThreads];
+volatile int done[NumThreads];
+int nextSlice;
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+void
+Fail(char *what)
+{
+    Say("forktest: FAIL ");
+    Say(what);
+    Say("\n");
+    Exit(1);
+}
+
+/* Body of each forked thread.  The slice is claimed with 
+ * CompareAndSwap, since Fork passes no argument.
+ */
+void
+Summer()
+{
+    int me, i, sum = 0;
+
+    do
+	me = nextSlice;
+    while (CompareAndSwap(&nextSlice, me, me + 1) != me);
+    for (i = me * Slice; i < (me + 1) * Slice; i++) {
+	sum += data[i];
+	if (i % 5 == 0)
+	    Yield();			/* let the others interleave */
+    }
+    sums[me] = sum;
+    done[me] = 1;
+    Exit(0);
+}
+
+int
+main()
+{
+    int i, total, expected = 0;
+
+    for (i = 0; i < NumThreads * Slice; i++) {
+	data[i] = i;
+	expected += i;
+    }
+    for (i = 0; i < NumThreads; i++)
+	if (Fork(Summer) != 0)
+	    Fail("Fork");
+
+    for (i = 0; i < NumThreads; i++)
+	while (!done[i])
+	    Yield();
+    total = 0;
+    for (i = 0; i < NumThreads; i++)
+	total += sums[i];
+    if (total != expected)
+	Fail("sum of the slices");
+
+    Say("forktest: ok\n");
+    Exit(0);
+}
@@ -0,0 +1,115 @@
+/* futextest.c
+ *	Test FutexWait and FutexWake, with a mutex built on CompareAndSwap.
+ *
+ *	The mutex word is 0 when free, 1 when held, and 2 when held with 
+ *	threads (maybe) asleep on it: only then does unlocking cost a 
+ *	system call.  NumThreads threads each add to a shared counter 
+ *	NumRounds times, yielding inside the critical section so that the 
+ *	others must wait.  The main thread sleeps on a futex until they 
+ *	are all done, then checks the counter.  Exit 0 if all is well.
+ */
+
+#include "syscall.h"
+
+#define NumThreads	4
+#define NumRounds	10
+
+int mutex;
+volatile int counter;
+int finished;
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+void
+Fail(char *what)
+{
+    Say("futextest: FAIL ");
+    Say(what);
+    Say("\n");
+    Exit(1);
+}
+
+/* Atomically set *addr to "value", and return what it held. */
+int
+Swap(int *addr, int value)
+{
+    int old;
+
+    do
+	old = *addr;
+    while (CompareAndSwap(addr, old, value) != old);
+    return old;
+}
+
+void
+Lock(int *m)
+{
+    int c;
+
+    if ((c = CompareAndSwap(m, 0, 1)) == 0)
+	return;				/* it was free */
+    if (c != 2)
+	c = Swap(m, 2);
+    while (c != 0) {
+	FutexWait(m, 2);
+	c = Swap(m, 2);
+    }
+}
+
+void
+Unlock(int *m)
+{
+    if (Swap(m, 0) == 2)
+	FutexWake(m, 1);
+}
+
+void
+Adder()
+{
+    int i, value;
+
+    for (i = 0; i < NumRounds; i++) {
+	Lock(&mutex);
+	value = counter;
+	Yield();
+	counter = value + 1;
+	Unlock(&mutex);
+    }
+    Lock(&mutex);
+    finished++;
+    Unlock(&mutex);
+    FutexWake(&finished, 1);
+    Exit(0);
+}
+
+int
+main()
+{
+    int i, f, word = 5;
+
+    if (FutexWait(&word, 4) != -1)
+	Fail("FutexWait on a changed word");
+    if (FutexWake(&word, 1) != 0)
+	Fail("FutexWake with nobody waiting");
+
+    for (i = 0; i < NumThreads; i++)
+	if (Fork(Adder) != 0)
+	    Fail("Fork");
+    while ((f = *(volatile int *) &finished) < NumThreads)
+	FutexWait(&finished, f);
+    if (counter != NumThreads * NumRounds)
+	Fail("counter");
+    if (mutex != 0)
+	Fail("mutex left held");
+
+    Say("futextest: ok\n");
+    Exit(0);
+}
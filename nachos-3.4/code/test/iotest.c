@@ -0,0 +1,114 @@
+/* iotest.c
+ *	Test IoEnter: asynchronous reads and writes through an I/O ring.
+ *
+ *	Queue two writes to a new file and wait for both; then read the 
+ *	file back with one request, and check the data.  A request with 
+ *	a bad opcode must complete at once, with -1.  Exit 0 if all is 
+ *	well.
+ */
+
+#include "syscall.h"
+
+#define Entries		4
+#define Half		64
+
+IoRing ring;
+IoRequest sq[Entries];
+IoCompletion cq[Entries];
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+void
+Fail(char *what)
+{
+    Say("iotest: FAIL ");
+    Say(what);
+    Say("\n");
+    Exit(1);
+}
+
+/* Queue a request at the tail of the submission ring. */
+void
+Queue(int opcode, int fd, char *buf, int length, int offset, int userData)
+{
+    IoRequest *req = &sq[ring.sqTail % Entries];
+
+    req->opcode = opcode;
+    req->fd = fd;
+    req->buf = buf;
+    req->length = length;
+    req->offset = offset;
+    req->userData = userData;
+    ring.sqTail++;
+}
+
+/* Reap the next completion; return its result, after checking that it
+ * belongs to the request with "userData" (or, if that is -1, to either 
+ * of the two writes).
+ */
+int
+Reap(int userData)
+{
+    IoCompletion *cqe;
+
+    if (ring.cqHead == ring.cqTail)
+	Fail("completion missing");
+    cqe = &cq[ring.cqHead % Entries];
+    if (userData == -1 ? (cqe->userData != 1 && cqe->userData != 2)
+		       : cqe->userData != userData)
+	Fail("completion of the wrong request");
+    ring.cqHead++;
+    return cqe->result;
+}
+
+int
+main()
+{
+    char out[2 * Half], in[2 * Half];
+    OpenFileId fd;
+    int i;
+
+    for (i = 0; i < 2 * Half; i++) {
+	out[i] = 'A' + i % 26;
+	in[i] = 0;
+    }
+    if (Create("iotest.dat") != 0 || (fd = Open("iotest.dat")) < 0)
+	Fail("Create or Open");
+
+    ring.entries = Entries;
+    ring.sq = sq;
+    ring.cq = cq;
+    ring.sqHead = ring.sqTail = ring.cqHead = ring.cqTail = 0;
+
+    Queue(IO_WRITE, fd, out, Half, 0, 1);
+    Queue(IO_WRITE, fd, &out[Half], Half, Half, 2);
+    if (IoEnter(&ring, 2, 2) != 2)
+	Fail("IoEnter of the writes");
+    if (Reap(-1) != Half || Reap(-1) != Half)
+	Fail("result of a write");
+
+    Queue(IO_READ, fd, in, 2 * Half, 0, 3);
+    if (IoEnter(&ring, 1, 1) != 1)
+	Fail("IoEnter of the read");
+    if (Reap(3) != 2 * Half)
+	Fail("result of the read");
+    for (i = 0; i < 2 * Half; i++)
+	if (in[i] != out[i])
+	    Fail("data read back");
+
+    Queue(99, fd, in, 1, 0, 4);
+    if (IoEnter(&ring, 1, 1) != 1 || Reap(4) != -1)
+	Fail("bad request");
+
+    Close(fd);
+    Say("iotest: ok\n");
+    Exit(0);
+}
@@ -0,0 +1,75 @@
+/* mmaptest.c
+ *	Test Mmap and Munmap.
+ *
+ *	Write a pattern to a new file, map it, and check that the mapping 
+ *	shows the file; change it through the mapping, unmap it, and check 
+ *	that the change reached the file.  Mapping a bad descriptor, and 
+ *	unmapping an address that is not mapped, must fail.  Exit 0 if 
+ *	all is well.
+ */
+
+#include "syscall.h"
+
+#define Size	300		/* spans a few pages */
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+void
+Fail(char *what)
+{
+    Say("mmaptest: FAIL ");
+    Say(what);
+    Say("\n");
+    Exit(1);
+}
+
+int
+main()
+{
+    char buf[Size];
+    char *map;
+    OpenFileId fd;
+    int i, addr;
+
+    for (i = 0; i < Size; i++)
+	buf[i] = 'a' + i % 26;
+    if (Create("mmaptest.dat") != 0 || (fd = Open("mmaptest.dat")) < 0)
+	Fail("Create or Open");
+    if (Write(buf, Size, fd) != Size)
+	Fail("Write");
+
+    if ((addr = Mmap(fd, 0, Size)) == -1)
+	Fail("Mmap");
+    map = (char *) addr;
+    for (i = 0; i < Size; i++)
+	if (map[i] != buf[i])
+	    Fail("mapped data");
+    for (i = 0; i < Size; i++)
+	map[i] = 'A' + i % 26;
+    if (Munmap(map) != 0)
+	Fail("Munmap");
+    if (Munmap(map) != -1)
+	Fail("second Munmap");
+    Close(fd);
+
+    if ((fd = Open("mmaptest.dat")) < 0 || Read(buf, Size, fd) != Size)
+	Fail("reading the file back");
+    for (i = 0; i < Size; i++)
+	if (buf[i] != 'A' + i % 26)
+	    Fail("data written through the mapping");
+    Close(fd);
+
+    if (Mmap(99, 0, Size) != -1)
+	Fail("Mmap of a bad descriptor");
+
+    Say("mmaptest: ok\n");
+    Exit(0);
+}
@@ -130,6 +130,93 @@ Yield:
 	j	$31
 	.end Yield
 
+	.globl FutexWait
+	.ent	FutexWait
+FutexWait:
+	addiu $2,$0,SC_FutexWait
+	syscall
+	j	$31
+	.end FutexWait
+
+	.globl FutexWake
+	.ent	FutexWake
+FutexWake:
+	addiu $2,$0,SC_FutexWake
+	syscall
+	j	$31
+	.end FutexWake
+
+	.globl IoEnter
+	.ent	IoEnter
+IoEnter:
+	addiu $2,$0,SC_IoEnter
+	syscall
+	j	$31
+	.end IoEnter
+
+	.globl Mmap
+	.ent	Mmap
+Mmap:
+	addiu $2,$0,SC_Mmap
+	syscall
+	j	$31
+	.end Mmap
+
+	.globl Munmap
+	.ent	Munmap
+Munmap:
+	addiu $2,$0,SC_Munmap
+	syscall
+	j	$31
+	.end Munmap
+
+	.globl GetUsage
+	.ent	GetUsage
+GetUsage:
+	addiu $2,$0,SC_GetUsage
+	syscall
+	j	$31
+	.end GetUsage
+
+	.globl SetLimit
+	.ent	SetLimit
+SetLimit:
+	addiu $2,$0,SC_SetLimit
+	syscall
+	j	$31
+	.end SetLimit
+
+	.globl Checkpoint
+	.ent	Checkpoint
+Checkpoint:
+	addiu $2,$0,SC_Checkpoint
+	syscall
+	j	$31
+	.end Checkpoint
+
+/* CompareAndSwap(addr, old, new): not a system call, but an LL/SC loop,
+ * run entirely in user mode.  The simulator delays the result of LL and
+ * SC by one instruction, like any load, hence the nops.
+ */
+	.globl CompareAndSwap
+	.ent	CompareAndSwap
+CompareAndSwap:
+	.set	noreorder
+	.set	mips2
+1:	ll	$2,0($4)
+	nop
+	bne	$2,$5,2f
+	move	$8,$6
+	sc	$8,0($4)
+	nop
+	beq	$8,$0,1b
+	nop
+2:	j	$31
+	nop
+	.set	mips0
+	.set	reorder
+	.end CompareAndSwap
+
               .globl Print
 	.ent	Print
 Print:
@@ -138,6 +225,14 @@ Print:
 	j	$31
 	.end Print
 
+	.globl Sbrk
+	.ent	Sbrk
+Sbrk:
+	addiu $2,$0,SC_Sbrk
+	syscall
+	j	$31
+	.end Sbrk
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,91 @@
+/* usagetest.c
+ *	Test GetUsage and SetLimit.
+ *
+ *	Check the counts of the calling thread and of the program, then 
+ *	put a resident limit on the program and touch more pages than it 
+ *	allows, and finally Exec "sort" (cf. sort.c) with a CPU limit far 
+ *	too small for it, which must stop it.  Run from the directory 
+ *	above test, like the other test programs; exit 0 if all is well.
+ */
+
+#include "syscall.h"
+
+#define BigSize		4096	/* ints; many more pages than the limit */
+#define Resident	8
+
+int big[BigSize];
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+void
+Fail(char *what)
+{
+    Say("usagetest: FAIL ");
+    Say(what);
+    Say("\n");
+    Exit(1);
+}
+
+int
+main()
+{
+    ProcessUsage thread, process;
+    SpaceId child;
+    int i, sum, used;
+
+    Yield();
+    Yield();
+    Yield();
+    if (GetUsage(USAGE_THREAD, &thread) != 0)
+	Fail("GetUsage of the thread");
+    if (thread.syscalls[SC_Yield] != 3 || thread.syscalls[SC_GetUsage] != 1)
+	Fail("system calls counted");
+    if (thread.userTicks <= 0)
+	Fail("user time");
+    if (GetUsage(USAGE_PROCESS, &process) != 0)
+	Fail("GetUsage of the program");
+    if (process.userTicks < thread.userTicks || process.residentPages <= 0
+	    || process.maxResident < process.residentPages
+	    || process.workingSet <= 0)
+	Fail("usage of the program");
+    if (GetUsage(12345, &process) != -1)
+	Fail("GetUsage of a bad SpaceId");
+
+    if (SetLimit(LIMIT_RESIDENT, 2) != -1)
+	Fail("resident limit below the minimum");
+    if (SetLimit(99, 1) != -1)
+	Fail("limit of a bad resource");
+    if (SetLimit(LIMIT_RESIDENT, Resident) != 0)
+	Fail("SetLimit of the resident set");
+    for (i = 0; i < BigSize; i++)
+	big[i] = i;
+    for (sum = 0, i = 0; i < BigSize; i++)
+	sum += big[i];
+    if (sum != BigSize * (BigSize - 1) / 2)
+	Fail("data paged against the resident limit");
+    GetUsage(USAGE_PROCESS, &process);
+    if (process.residentPages > Resident)
+	Fail("resident limit exceeded");
+    if (SetLimit(LIMIT_RESIDENT, 0) != Resident)
+	Fail("removing the resident limit");
+
+    used = process.userTicks + process.systemTicks;
+    if (SetLimit(LIMIT_CPU, used + 20000) != 0)
+	Fail("SetLimit of the CPU");
+    if ((child = Exec("../test/sort")) < 0)
+	Fail("Exec sort");
+    if (Join(child) != -1)
+	Fail("sort not stopped at its CPU limit");
+    SetLimit(LIMIT_CPU, 0);
+
+    Say("usagetest: ok\n");
+    Exit(0);
+}
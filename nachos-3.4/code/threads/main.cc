@@ -9,9 +9,15 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-s -x <nachos file> -rx <checkpoint file>
+//		-c <consoleIn> <consoleOut>
+//		-ps <page size> -np <# frames> -tlb <# TLB entries>
+//		-tw <TLB ways> -us <stack size> -cf <config file>
+//		-pt linear|radix|hash
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
+//		-md <nachos dir>
+//		-ds fcfs|sstf|clook|deadline -dt -dm -dms
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
 //              -z
@@ -23,16 +29,30 @@
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
+//    -rx runs a user program again from a checkpoint it saved
 //    -c tests the console
+//    -ps, -np, -tlb, -us set the page size, the number of physical
+//	pages, the number of TLB entries and the user stack size
+//    -tw sets the associativity of the TLB
+//    -pt chooses the page table: linear (the default), or a two-level
+//	or hashed one, which also give programs a sparse address space
+//	with the stack at the top
+//    -cf reads any of those from a file of "<name> <value>" lines
+//	(PageSize, NumPhysPages, TLBSize, TLBWays, UserStackSize)
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -r removes a Nachos file (or empty directory) from the file system
+//    -md makes a Nachos directory
+//    -l lists the contents of every Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
+//    -ds chooses the order in which queued disk requests are served
+//    -dt measures disk request latency with several concurrent readers
+//    -dm keeps the DISK file mapped in memory, written back on flushes
+//	and at shutdown; -dms writes each sector back as it is written
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -61,7 +81,9 @@ extern int testnum;
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
+extern void DiskSchedTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
+extern void RestoreProcess(char *file);
 extern void TestMultProcess();
 extern void MailTest(int networkID);
 
@@ -114,6 +136,10 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-rx")) {	// restore a user program
+	    ASSERT(argc > 1);
+            RestoreProcess(*(argv + 1));
+            argCount = 2;
         } else if (!strcmp(*argv, "-mx")) {
             //
             TestMultProcess();
@@ -144,12 +170,18 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    fileSystem->Remove(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-md")) {	// make Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->Mkdir(*(argv + 1));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-l")) {	// list Nachos directory
             fileSystem->List();
 	} else if (!strcmp(*argv, "-D")) {	// print entire filesystem
             fileSystem->Print();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
+	} else if (!strcmp(*argv, "-dt")) {	// disk scheduling test
+            DiskSchedTest();
 	}
 #endif // FILESYS
 #ifdef NETWORK
@@ -28,10 +28,17 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+Journal     *journal;
 #endif
 
 #ifdef USER_PROGRAM // requires either FILESYS or FILESYS_STUB
 Machine *machine;   // user program memory and registers
+PageCache *pageCache;   // code frames shared between programs
+ImageCache *imageCache; // parsed executables
+ProcessTable *processTable; // programs, for Exec and Join
+FutexTable *futexTable;     // user threads waiting on a lock word
+IoService *ioService;       // asynchronous I/O for user programs
+SynchConsole *synchConsole;
 #endif
 
 #ifdef NETWORK
@@ -66,8 +73,54 @@ TimerInterruptHandler(int dummy)
     
     if (interrupt->getStatus() != IdleMode)
     interrupt->YieldOnReturn();
+#ifdef FILESYS
+    if (synchDisk != NULL)          // periodic write-back of the cache
+        synchDisk->WakeFlusher();
+#endif
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// ReadMachineConfig
+//  Set the size of the simulated memory from a config file.  Each 
+//  line is a parameter name and a value, e.g. "NumPhysPages 64"; 
+//  blank lines and lines starting with '#' are ignored.  Known 
+//  names are PageSize, NumPhysPages, TLBSize, TLBWays and 
+//  UserStackSize.
+//
+//  "name" -- the UNIX file holding the configuration
+//----------------------------------------------------------------------
+static void
+ReadMachineConfig(char *name)
+{
+    FILE *f = fopen(name, "r");
+    char line[128], key[64];
+    int value;
+
+    if (f == NULL) {
+        printf("Can not open config file %s\n", name);
+        ASSERT(FALSE);
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%63s %d", key, &value) != 2)
+            continue;
+        if (!strcmp(key, "PageSize"))
+            PageSize = value;
+        else if (!strcmp(key, "NumPhysPages"))
+            NumPhysPages = value;
+        else if (!strcmp(key, "TLBSize"))
+            TLBSize = value;
+        else if (!strcmp(key, "TLBWays"))
+            TLBWays = value;
+        else if (!strcmp(key, "UserStackSize"))
+            UserStackSize = value;
+        else
+            printf("Unknown config parameter %s\n", key);
+    }
+    fclose(f);
+}
+#endif
+
 //----------------------------------------------------------------------
 // Initialize
 //  Initialize Nachos global data structures.  Interpret command
@@ -115,11 +168,63 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
     if (!strcmp(*argv, "-s"))
         debugUserProg = TRUE;
+    else if (!strcmp(*argv, "-cf")) {   // machine config file
+        ASSERT(argc > 1);
+        ReadMachineConfig(*(argv + 1));
+        argCount = 2;
+    } else if (!strcmp(*argv, "-ps")) { // page size
+        ASSERT(argc > 1);
+        PageSize = atoi(*(argv + 1));
+        argCount = 2;
+    } else if (!strcmp(*argv, "-np")) { // number of physical pages
+        ASSERT(argc > 1);
+        NumPhysPages = atoi(*(argv + 1));
+        argCount = 2;
+    } else if (!strcmp(*argv, "-tlb")) {    // number of TLB entries
+        ASSERT(argc > 1);
+        TLBSize = atoi(*(argv + 1));
+        argCount = 2;
+    } else if (!strcmp(*argv, "-tw")) { // TLB associativity
+        ASSERT(argc > 1);
+        TLBWays = atoi(*(argv + 1));
+        argCount = 2;
+    } else if (!strcmp(*argv, "-pt")) { // page table organization
+        ASSERT(argc > 1);
+        if (!strcmp(*(argv + 1), "radix"))
+            pageTableType = RadixTable;
+        else if (!strcmp(*(argv + 1), "hash"))
+            pageTableType = HashedTable;
+        else
+            pageTableType = LinearTable;
+        argCount = 2;
+    } else if (!strcmp(*argv, "-us")) { // user stack size
+        ASSERT(argc > 1);
+        UserStackSize = atoi(*(argv + 1));
+        argCount = 2;
+    }
 #endif
 #ifdef FILESYS_NEEDED
     if (!strcmp(*argv, "-f"))
         format = TRUE;
 #endif
+#ifdef FILESYS
+    if (!strcmp(*argv, "-ds")) {    // disk scheduling policy
+        ASSERT(argc > 1);
+        if (!strcmp(*(argv + 1), "sstf"))
+            diskSchedPolicy = SSTF;
+        else if (!strcmp(*(argv + 1), "clook"))
+            diskSchedPolicy = CLOOK;
+        else if (!strcmp(*(argv + 1), "deadline"))
+            diskSchedPolicy = DeadlineSched;
+        else
+            diskSchedPolicy = FCFS;
+        argCount = 2;
+    } else if (!strcmp(*argv, "-dm")) { // map the disk image
+        diskBacking = DiskMapped;
+    } else if (!strcmp(*argv, "-dms")) {    // ... and write through
+        diskBacking = DiskMappedSync;
+    }
+#endif
 #ifdef NETWORK
     if (!strcmp(*argv, "-l")) {
         ASSERT(argc > 1);
@@ -160,6 +265,11 @@ Initialize(int argc, char **argv)
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);   // this must come first
+    pageCache = new PageCache();
+    imageCache = new ImageCache();
+    processTable = new ProcessTable();
+    futexTable = new FutexTable();
+    ioService = new IoService();
 #endif
 
 #ifdef FILESYS
@@ -188,6 +298,12 @@ Cleanup()
 #endif
     
 #ifdef USER_PROGRAM
+    delete synchConsole;
+    delete ioService;
+    delete futexTable;
+    delete processTable;
+    delete imageCache;
+    delete pageCache;
     delete machine;
 #endif
 
@@ -196,6 +312,7 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete journal;			// commits what is left
     delete synchDisk;
 #endif
     
@@ -39,7 +39,20 @@ extern Timer *timer;                // the hardware alarm clock
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "pagecache.h"
 extern Machine* machine;    // user program memory and registers
+extern PageCache *pageCache;    // code frames shared between programs
+#include "imagecache.h"
+extern ImageCache *imageCache;  // parsed executables
+#include "proctable.h"
+extern ProcessTable *processTable;  // programs, for Exec and Join
+#include "futex.h"
+extern FutexTable *futexTable;  // user threads waiting on a lock word
+#include "ioring.h"
+extern IoService *ioService;    // asynchronous I/O for user programs
+#include "synchconsole.h"
+extern SynchConsole *synchConsole;  // console for Read/Write; made on 
+                                // first use
 #endif
 
 #ifdef FILESYS_NEEDED       // FILESYS or FILESYS_STUB 
@@ -49,7 +62,9 @@ extern FileSystem  *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "journal.h"
 extern SynchDisk   *synchDisk;
+extern Journal	   *journal;		// set up by the FileSystem
 #endif
 
 #ifdef NETWORK
@@ -53,6 +53,7 @@ Thread::Thread(char* threadName)
     }
 #ifdef USER_PROGRAM
     space = NULL;
+    stackSlot = 0;
 #endif
 }
 
@@ -76,7 +77,10 @@ Thread::~Thread()
     if (stack != NULL)
     DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
 #ifdef USER_PROGRAM
-    delete space;
+    // Threads made by Fork share their address space; the last one 
+    // to go deletes it.
+    if (space != NULL && --space->refCount == 0)
+        delete space;
 #endif
 }
 
@@ -174,6 +178,10 @@ Thread::Finish ()
     allThreads[id]=0;
     threadCount--;
     threadsInfo[id] = NULL;
+#ifdef USER_PROGRAM
+    if (space != NULL)          // its process keeps its counts
+        space->usage.Add(&usage);
+#endif
 
     threadToBeDestroyed = currentThread;
     
@@ -345,5 +353,6 @@ Thread::RestoreUserState()
 {
     for (int i = 0; i < NumTotalRegs; i++)
     machine->WriteRegister(i, userRegisters[i]);
+    machine->llBit = FALSE;     // another thread may have run
 }
 #endif
\ No newline at end of file
@@ -39,6 +39,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "stats.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -114,6 +115,8 @@ class Thread {
     void setPriority(int _p) { priority = _p; }
     int getPriority() { return priority; }
 
+    Usage usage;                // resources used so far, cf. GetUsage
+
   private:
     // some of the private data for this class is listed above
     
@@ -143,6 +146,7 @@ class Thread {
     void RestoreUserState();        // restore user-level register state
 
     AddrSpace *space;           // User code this thread is running.
+    int stackSlot;              // Which of the space's stacks is ours
     
 
 #endif
@@ -22,27 +22,7 @@
 #include <strings.h>
 #endif
 
-//----------------------------------------------------------------------
-// SwapHeader
-//  Do little endian to big endian conversion on the bytes in the 
-//  object file header, in case the file was generated on a little
-//  endian machine, and we're now running on a big endian machine.
-//----------------------------------------------------------------------
-
-static void 
-SwapHeader (NoffHeader *noffH)
-{
-    noffH->noffMagic = WordToHost(noffH->noffMagic);
-    noffH->code.size = WordToHost(noffH->code.size);
-    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
-    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
-    noffH->initData.size = WordToHost(noffH->initData.size);
-    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
-    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
-    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
-    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
-    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
-}
+int UserStackSize = DefaultUserStackSize;
 
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
@@ -62,42 +42,57 @@ SwapHeader (NoffHeader *noffH)
 AddrSpace::AddrSpace(OpenFile *executable)
 {
     unsigned int i, size;
-    NoffHeader noffH;
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && 
-        (WordToHost(noffH.noffMagic) == NOFFMAGIC))
-        SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    // The executable is parsed and read only the first time it is run; 
+    // after that, the image cache has it.
+    image = imageCache->Get(executable);
+    NoffHeader &noffH = image->noffH;
 
-   
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
-            + UserStackSize;    // we need to increase the size
-                        // to leave room for the stack
-    numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
+    // The image (code, data and bss) starts at 0, and the heap right
+    // after it.  The stacks are at the top: LinearGapPages above the 
+    // image with a linear page table, at UserSpaceTop with a sparse 
+    // one.  The heap grows up into the gap with Sbrk, and mapped files 
+    // are put in it from the top down.  Room is kept for the stacks of 
+    // MaxUserThreads threads, but only the first thread's is in use.
+    heapStart = brk = noffH.code.size + noffH.initData.size 
+            + noffH.uninitData.size;
+    int imagePages = divRoundUp(heapStart, PageSize);
+    stackPages = divRoundUp(UserStackSize, PageSize);
+    numPages = imagePages + LinearGapPages + MaxUserThreads * stackPages;
+    if (pageTableType != LinearTable 
+            && (unsigned) UserSpaceTop / PageSize > numPages)
+        numPages = UserSpaceTop / PageSize;
 
-  //  ASSERT(numPages <= NumPhysPages);     // check we're not trying
-                        // to run anything too big --
-                        // at least until we have
-                        // virtual memory
+    // Pages are loaded from the cached image until they are first 
+    // written out; then they get a slot in the swap file.
+    nextSwapPage = 0;
+    lastFaultPage = -1;
+    faultStride = 0;
+    prefetchWindow = 0;
+    pid = -1;
+    execName = NULL;
+    cpuLimit = residentLimit = 0;
+    stackMap = new BitMap(MaxUserThreads);
+    stackMap->Mark(0);
+    numThreads = refCount = 1;
+    fileTable = new FileTable;
+    io = NULL;
+    mappings = NULL;
+    size = (imagePages + stackPages) * PageSize;
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n", 
                     numPages, size);
 // first, set up the translation 
  
-     pageTable = new TranslationEntry[numPages];
+     asid = machine->AllocateASID(this);
+     pageTable = NewPageTable(numPages);
     printf("PageTable Address: 0x%x\n", (unsigned int)pageTable);
-    for (i = 0; i < numPages; ++i) {
-        pageTable[i].valid = FALSE;
-        pageTable[i].dirty = FALSE;
-    }
-    char* threadName = currentThread->getName();
+    // The swap file is named after the ASID, not the running thread: 
+    // with Exec, the space is built by the parent, for another thread.
     char fileName[32];
-    strcpy(fileName, threadName);
-    char* endFile = ".va";
-    strcat(fileName, endFile);
-    vaName = fileName;
+    sprintf(fileName, "swap%d.va", asid);
+    vaName = new char[strlen(fileName) + 1];
+    strcpy(vaName, fileName);
     if (fileSystem->Create(fileName, size))
         vaSpace = fileSystem->Open(fileName);
     else {
@@ -111,58 +106,274 @@ AddrSpace::AddrSpace(OpenFile *executable)
     printf("Code: 0x%x, 0x%x, 0x%x\n", noffH.code.virtualAddr, noffH.code.inFileAddr, noffH.code.size);
     printf("Data:  0x%x, 0x%x, 0x%x\n", noffH.initData.virtualAddr, noffH.initData.inFileAddr, noffH.initData.size);
     printf("UninitDate: 0x%x,  0x%x,  0x%x\n", noffH.uninitData.virtualAddr, noffH.uninitData.inFileAddr, noffH.uninitData.size);
-// then, copy in the code and data segments into virtualspace
-
-    char* tempContainer = new char[size];
-    if (noffH.code.size > 0) {
-        DEBUG('a', "Initializing code segment, at 0x%x, size %d\n", 
-            noffH.code.virtualAddr, noffH.code.size);
-        executable->ReadAt(&(tempContainer[0]), noffH.code.size, noffH.code.inFileAddr);
-        vaSpace->WriteAt(&(tempContainer[0]), noffH.code.size, 0);
-    }
-    if (noffH.initData.size > 0) {
-        DEBUG('a', "Initializing data segment, at 0x%x, size %d\n", 
-            noffH.initData.virtualAddr, noffH.initData.size);
-        executable->ReadAt(&(tempContainer[noffH.code.size]), noffH.initData.size, noffH.initData.inFileAddr);
-        vaSpace->WriteAt(&(tempContainer[noffH.code.size]), noffH.initData.size, noffH.code.size);
-    }
-    delete tempContainer;
+
+    // Whole pages of code are shared, through the page cache, with 
+    // every other address space running the same executable.  The 
+    // last code page may also hold initialized data, so it is private.
+    codeKey = image->id;
+    if (noffH.code.virtualAddr == 0)
+        sharedCodePages = noffH.code.size / PageSize;
+    else
+        sharedCodePages = 0;
     
     int codePages = divRoundUp(noffH.code.size, PageSize);
     for (i = 0; i < codePages; ++i) {
-        int ppn = machine->mBitMap->Find();
-        if (ppn == -1) {
+        if (machine->mBitMap->NumClear() == 0) {
             printf("The physical memory is Full!\n");
             break;
         }
-        //printf("PPN %d\n", ppn);
-        pageTable[i].physicalPage = ppn;
-        pageTable[i].virtualPage = i;
-        pageTable[i].valid = TRUE;
-        pageTable[i].use = FALSE;
-        pageTable[i].dirty = FALSE;
-        pageTable[i].readOnly = FALSE;
-        vaSpace->ReadAt(&(machine->mainMemory[ppn*PageSize]), PageSize, i*PageSize);
-        machine->physPageTable[ppn].vaPageNum = i;
-        machine->physPageTable[ppn].valid = TRUE;
-        machine->physPageTable[ppn].dirty = FALSE;
-        machine->physPageTable[ppn].heldThreadID = currentThread->GetThreadID();
+        machine->PageIn(this, i);
     }
     
    
     printf("hahhahaha\n");
 }
 
+//----------------------------------------------------------------------
+// ReleasePage
+//  Mapcar helper for ~AddrSpace: give back one page's frame.
+//----------------------------------------------------------------------
+
+static void
+ReleasePage(TranslationEntry *entry, void *space)
+{
+    ((AddrSpace *) space)->ReleaseFrame(entry);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-//  Dealloate an address space.  Nothing for now!
+//  Dealloate an address space.  Give back the frames it holds: 
+//  private frames are freed, shared code frames just lose a 
+//  reference and stay in the page cache.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
+   while (mappings != NULL)     // save what was written to them
+       Munmap(mappings->start * PageSize);
+   machine->FreeASID(asid);
+   DEBUG('a', "Page table: %d entries, %d bytes\n", 
+         pageTable->NumEntries(), pageTable->Size());
+   pageTable->Mapcar(ReleasePage, this);
    delete pageTable;
-   fileSystem->Remove(vaName);
+   delete stackMap;
+   delete io;
+   delete fileTable;
+   imageCache->Release(image);
+   delete [] execName;
    delete vaSpace;
+   fileSystem->Remove(vaName);
+   delete [] vaName;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseFrame
+//  Unmap a page.  A private frame goes back to the free pool; a 
+//  shared code frame just loses our reference.  The caller must make 
+//  sure no TLB entry still maps the page.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReleaseFrame(TranslationEntry *entry)
+{
+    if (!entry->valid)
+        return;
+    int ppn = entry->physicalPage;
+    if (IsSharedCode(entry->virtualPage))
+        pageCache->Detach(ppn, codeKey, entry->virtualPage);
+    else if (machine->physPageTable[ppn].space == this) {
+        machine->physPageTable[ppn].valid = FALSE;
+        machine->physPageTable[ppn].dirty = FALSE;
+        machine->physPageTable[ppn].space = NULL;
+        machine->mBitMap->Clear(ppn);
+    }
+    entry->valid = FALSE;
+    usage.residentPages--;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsSharedCode
+//  Return TRUE if virtual page "vpn" contains nothing but program 
+//  code, so that it can be mapped read-only from the page cache.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsSharedCode(int vpn)
+{
+    return vpn >= 0 && vpn < sharedCodePages;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsValidPage
+//  Return TRUE if virtual page "vpn" may be referenced: it lies in 
+//  the program image or the heap (below the break), or in the stack 
+//  of one of our threads.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsValidPage(int vpn)
+{
+    if (vpn < 0 || vpn >= (int) numPages)
+        return FALSE;
+    if (vpn < divRoundUp(brk, PageSize))
+        return TRUE;
+    int slot = ((int) numPages - 1 - vpn) / stackPages;
+    if (slot < MaxUserThreads)
+        return stackMap->Test(slot);
+    return FindMapping(vpn) != NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Sbrk
+//  Grow (or shrink) the heap by "increment" bytes.  Growing just 
+//  moves the break: the new pages are zero filled when first touched, 
+//  and only then get a page table entry.  Pages given back by 
+//  shrinking lose their frame and their contents.
+//
+//  Returns the old break, or -1 if the heap would run into the mapped 
+//  files or the stacks, or below the program image.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Sbrk(int increment)
+{
+    int oldBrk = brk;
+    int newBrk = brk + increment;
+
+    if (newBrk < heapStart 
+            || newBrk > MapFloor() * PageSize)
+        return -1;
+    if (newBrk < oldBrk) {
+        machine->FlushASID(asid);
+        for (int vpn = divRoundUp(newBrk, PageSize); 
+                vpn < divRoundUp(oldBrk, PageSize); vpn++) {
+            TranslationEntry *entry = pageTable->Lookup(vpn);
+            if (entry != NULL) {
+                ReleaseFrame(entry);
+                entry->backingPage = -1;
+            }
+        }
+    }
+    brk = newBrk;
+    DEBUG('a', "Sbrk %d: break 0x%x -> 0x%x\n", increment, oldBrk, newBrk);
+    return oldBrk;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::NoteFault
+//  Record a demand fault on "vpn".  Once two faults in a row are the 
+//  same (small) distance apart, the program is scanning: ask for 
+//  readahead along that stride, doubling the window each time the 
+//  pattern holds, up to MaxPrefetchPages.  Any other fault resets it.
+//
+//  Returns the number of pages to prefetch, and the stride in "stride".
+//----------------------------------------------------------------------
+
+int
+AddrSpace::NoteFault(int vpn, int *stride)
+{
+    int delta = vpn - lastFaultPage;
+
+    if (delta != 0 && delta == faultStride 
+            && delta <= MaxPrefetchStride && delta >= -MaxPrefetchStride) {
+        if (prefetchWindow == 0)
+            prefetchWindow = 1;
+        else if (prefetchWindow < MaxPrefetchPages)
+            prefetchWindow *= 2;
+    } else {
+        faultStride = delta;
+        prefetchWindow = 0;
+    }
+    lastFaultPage = vpn;
+    *stride = faultStride;
+    return prefetchWindow;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WorkingSetSize
+//  Count our resident pages, private or shared, that have been used 
+//  within the last WorkingSetWindow ticks.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::WorkingSetSize()
+{
+    int count = 0;
+
+    for (int ppn = 0; ppn < NumPhysPages; ppn++) {
+        PhysicalPage *frame = &machine->physPageTable[ppn];
+        if (!frame->valid 
+                || frame->lastUsedTime < stats->totalTicks - WorkingSetWindow)
+            continue;
+        if (frame->space == this)
+            count++;
+        else if (frame->space == NULL && pageCache->IsCached(ppn)) {
+            TranslationEntry *entry = pageTable->Lookup(frame->vaPageNum);
+            if (entry != NULL && entry->valid && entry->physicalPage == ppn)
+                count++;
+        }
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadIn
+//  Fill frame "ppn" with the page described by "entry": from its file
+//  if it is mapped, from the swap file if the page has been saved 
+//  there, from the cached executable image if it holds code or 
+//  initialized data, otherwise with zeroes.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReadIn(TranslationEntry *entry, int ppn)
+{
+    char *frame = &machine->mainMemory[ppn * PageSize];
+    int offset = entry->virtualPage * PageSize;
+
+    // 交换文件可能比该页短（如数据段末尾），先清零
+    Mapping *map = FindMapping(entry->virtualPage);
+
+    bzero(frame, PageSize);
+    if (map != NULL) {
+        int start = (entry->virtualPage - map->start) * PageSize;
+        if (start < map->length)
+            map->file->ReadAt(frame, min(PageSize, map->length - start),
+                              map->offset + start);
+    } else if (entry->backingPage != -1)
+        vaSpace->ReadAt(frame, PageSize, entry->backingPage * PageSize);
+    else if (offset < image->loadSize)
+        bcopy(&image->contents[offset], frame, 
+              min(PageSize, image->loadSize - offset));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteBack
+//  Save frame "ppn", holding the page described by "entry": a mapped 
+//  page goes back to its file; any other to the swap file, where a 
+//  page written for the first time is given the next free slot.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteBack(TranslationEntry *entry, int ppn)
+{
+    Mapping *map = FindMapping(entry->virtualPage);
+
+    if (map != NULL) {
+        int start = (entry->virtualPage - map->start) * PageSize;
+        if (start < map->length)
+            map->file->WriteAt(&machine->mainMemory[ppn * PageSize], 
+                               min(PageSize, map->length - start), 
+                               map->offset + start);
+        return;
+    }
+    if (entry->backingPage == -1)
+        entry->backingPage = nextSwapPage++;
+    int written = vaSpace->WriteAt(&machine->mainMemory[ppn * PageSize],
+                PageSize, entry->backingPage * PageSize);
+    if (written != PageSize) {
+        printf("Swap file %s is full!\n", vaName);
+        ASSERT(FALSE);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -197,17 +408,246 @@ AddrSpace::InitRegisters()
     DEBUG('a', "Initializing stack register to %d\n", numPages * PageSize - 16);
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::InitThreadRegisters
+//  Set the user-level registers for a thread made by Fork: it starts 
+//  at the procedure "func", on the stack in slot "slot".  The thread 
+//  shares everything else -- code, data, heap, page table -- with the 
+//  other threads of the address space.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InitThreadRegisters(int func, int slot)
+{
+    for (int i = 0; i < NumTotalRegs; i++)
+        machine->WriteRegister(i, 0);
+    machine->WriteRegister(PCReg, func);
+    machine->WriteRegister(NextPCReg, func + 4);
+    machine->WriteRegister(StackReg, StackTop(slot) - 16);
+    DEBUG('a', "Thread starts at 0x%x, stack at 0x%x\n", func, 
+          StackTop(slot) - 16);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateStack
+//  Reserve a free stack slot for a new thread.  Its pages, like the 
+//  heap's, are zero filled when first touched.  Return the slot, or 
+//  -1 if MaxUserThreads stacks are already in use.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AllocateStack()
+{
+    return stackMap->Find();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreeStack
+//  A thread is done with stack "slot": give back the frames of its 
+//  pages, and forget their contents, so that the next thread to get 
+//  the slot starts with a clean stack.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::FreeStack(int slot)
+{
+    int top = StackTop(slot) / PageSize;
+
+    machine->FlushASID(asid);
+    for (int vpn = top - stackPages; vpn < top; vpn++) {
+        TranslationEntry *entry = pageTable->Lookup(vpn);
+        if (entry != NULL) {
+            ReleaseFrame(entry);
+            entry->backingPage = -1;
+        }
+    }
+    stackMap->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::StackTop
+//  Return the address just above stack "slot".
+//----------------------------------------------------------------------
+
+int
+AddrSpace::StackTop(int slot)
+{
+    return ((int) numPages - slot * stackPages) * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapFloor
+//  Return the lowest page of the mapped files, or, if there are none, 
+//  of the stacks.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::MapFloor()
+{
+    Mapping *map = mappings;
+    int floor = (int) numPages - MaxUserThreads * stackPages;
+
+    if (map != NULL)
+        while (map->next != NULL)
+            map = map->next;
+    return map != NULL ? map->start : floor;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindMapping
+//  Return the mapping that virtual page "vpn" is in, or NULL.
+//----------------------------------------------------------------------
+
+Mapping *
+AddrSpace::FindMapping(int vpn)
+{
+    for (Mapping *map = mappings; map != NULL; map = map->next)
+        if (vpn >= map->start && vpn < map->start + map->numPages)
+            return map;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Mmap
+//  Map "length" bytes of open file "fd", from "offset" on, into the 
+//  address space, at the highest free place below the stacks (and 
+//  above the heap).  Nothing is read yet: each page is faulted in 
+//  from the file when first touched, like any other page (cf. 
+//  Machine::PageIn), and written back to the file, if dirty, when it 
+//  is evicted or unmapped.  The part of the last page past "length" 
+//  is zero, and not written back.
+//
+//  The descriptor cannot be closed while the mapping exists.  Return 
+//  the address of the mapping, or -1 if "fd" is not an open file or 
+//  there is no room.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Mmap(int fd, int offset, int length)
+{
+    FileTableEntry *entry = fileTable->Get(fd);
+    int pages = divRoundUp(length, PageSize);
+    int top = (int) numPages - MaxUserThreads * stackPages;
+    int bottom = divRoundUp(brk, PageSize);
+    Mapping **pp, *map;
+
+    if (entry == NULL || entry->file == NULL || offset < 0 || length <= 0)
+        return -1;
+    // find the highest gap that fits, between the stacks, the mappings 
+    // (highest first) and the heap
+    for (pp = &mappings; *pp != NULL; pp = &(*pp)->next) {
+        if (top - ((*pp)->start + (*pp)->numPages) >= pages)
+            break;
+        top = (*pp)->start;
+    }
+    if (top - pages < bottom)
+        return -1;
+
+    map = new Mapping;
+    map->start = top - pages;
+    map->numPages = pages;
+    map->fd = fd;
+    map->file = entry->file;
+    map->offset = offset;
+    map->length = length;
+    map->next = *pp;
+    *pp = map;
+    entry->pending++;
+    DEBUG('a', "Mmap fd %d, %d bytes at %d: pages %d-%d\n", fd, length, 
+          offset, map->start, top - 1);
+    return map->start * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Munmap
+//  Remove the mapping that starts at "addr".  Its resident pages 
+//  that were written are saved to the file first; then they lose 
+//  their frame and their page table entry goes back to zero fill.  
+//  Return FALSE if no mapping starts at "addr".
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Munmap(int addr)
+{
+    Mapping **pp, *map;
+
+    for (pp = &mappings; *pp != NULL; pp = &(*pp)->next)
+        if ((*pp)->start * PageSize == addr)
+            break;
+    if (*pp == NULL)
+        return FALSE;
+    map = *pp;
+
+    machine->FlushASID(asid);
+    for (int vpn = map->start; vpn < map->start + map->numPages; vpn++) {
+        TranslationEntry *entry = pageTable->Lookup(vpn);
+        if (entry == NULL || !entry->valid)
+            continue;
+        int ppn = entry->physicalPage;
+        if (entry->dirty || machine->physPageTable[ppn].dirty)
+            WriteBack(entry, ppn);
+        ReleaseFrame(entry);
+        entry->backingPage = -1;
+    }
+    *pp = map->next;
+    fileTable->Get(map->fd)->pending--;
+    delete map;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetExecName
+//  Keep a copy of "name", the file the program was loaded from.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SetExecName(char *name)
+{
+    delete [] execName;
+    execName = new char[strlen(name) + 1];
+    strcpy(execName, name);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GetUsage
+//  Add up the resources used by the process into "total": the counts 
+//  its exited threads left behind, and those of its threads still 
+//  around.  The working set is left out: it takes a scan of physical 
+//  memory, so callers that report it measure it themselves.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::GetUsage(Usage *total)
+{
+    *total = usage;
+    for (int i = 0; i < MaxThreadNum; i++)
+        if (threadsInfo[i] != NULL && threadsInfo[i]->space == this)
+            total->Add(&threadsInfo[i]->usage);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AtResidentLimit
+//  Return TRUE if the space has a resident limit, and "extra" more 
+//  pages in memory would bring it there.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::AtResidentLimit(int extra)
+{
+    return residentLimit > 0 && usage.residentPages + extra >= residentLimit;
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::SaveState
 //  On a context switch, save any machine state, specific
 //  to this address space, that needs saving.
 //
-//  For now, nothing!
+//  Nothing: TLB entries are tagged with our ASID, so they can stay 
+//  in the TLB until we run again.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() 
 {
-    machine->ClearTLB();
 }
 
 //----------------------------------------------------------------------
@@ -221,5 +661,164 @@ void AddrSpace::SaveState()
 void AddrSpace::RestoreState() 
 {
     machine->pageTable = pageTable;
-    machine->pageTableSize = numPages;
-}
\ No newline at end of file
+    machine->currentASID = asid;
+}
+//----------------------------------------------------------------------
+// AddrSpace::UserPage
+//  Return where virtual page "vpn" is in main memory, paging it in if 
+//  it is not resident; or NULL if the page is not part of the address 
+//  space, or is read-only and we are "writing".  The use and dirty 
+//  bits are set, as Translate would for an access by the program.
+//----------------------------------------------------------------------
+
+char *
+AddrSpace::UserPage(int vpn, bool writing)
+{
+    TranslationEntry *entry;
+    PhysicalPage *frame;
+
+    if (!IsValidPage(vpn))
+        return NULL;
+    entry = pageTable->Lookup(vpn);
+    if (entry == NULL || !entry->valid) {
+        stats->numPageFaults++;
+        currentThread->usage.pageFaults++;
+        machine->PageIn(this, vpn);
+        entry = pageTable->Lookup(vpn);
+    }
+    if (writing && entry->readOnly)
+        return NULL;
+    frame = &machine->physPageTable[entry->physicalPage];
+    entry->use = TRUE;
+    entry->lastUsedTime = frame->lastUsedTime = stats->totalTicks;
+    if (writing)
+        entry->dirty = frame->dirty = TRUE;
+    return &machine->mainMemory[entry->physicalPage * PageSize];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Prefault
+//  Make the pages of user buffer ["addr", "addr" + "size") resident 
+//  in one pass, before copying it, so that the copy does not stop at 
+//  each page to fault.  After each missing page, the pages following 
+//  it are read ahead, with one read where their swap file copies are 
+//  consecutive (cf. Machine::Prefetch).  Return FALSE if some page 
+//  of the buffer is not part of the address space.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Prefault(int addr, int size)
+{
+    int first = (unsigned) addr / PageSize;
+    int last = (unsigned) (addr + size - 1) / PageSize;
+    TranslationEntry *entry;
+
+    for (int vpn = first; vpn <= last; vpn++) {
+        if (!IsValidPage(vpn))
+            return FALSE;
+        entry = pageTable->Lookup(vpn);
+        if (entry != NULL && entry->valid)
+            continue;
+        stats->numPageFaults++;
+        currentThread->usage.pageFaults++;
+        machine->PageIn(this, vpn);
+        if (vpn < last)
+            machine->Prefetch(this, vpn, 1, min(last - vpn, MaxPrefetchPages));
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn/CopyOut
+//  Copy "size" bytes between user virtual address "addr" and the 
+//  kernel buffer "buf", for system call arguments.  The buffer is 
+//  prefaulted, then copied a page at a time straight from or to main 
+//  memory: one translation per page, not one per byte as with 
+//  Machine::ReadMem/WriteMem.  A page evicted by the prefaulting of 
+//  a later one is simply faulted in again.
+//
+//  Return FALSE if the user buffer is not entirely in the address 
+//  space (or, for CopyOut, is in read-only code); part of it may 
+//  have been copied.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyIn(int addr, char *buf, int size)
+{
+    int offset, n;
+    char *page;
+
+    if (addr < 0 || size < 0)
+        return FALSE;
+    if (size == 0)
+        return TRUE;
+    if (!Prefault(addr, size))
+        return FALSE;
+    for (; size > 0; addr += n, buf += n, size -= n) {
+        offset = addr % PageSize;
+        n = min(size, PageSize - offset);
+        page = UserPage(addr / PageSize, FALSE);
+        if (page == NULL)
+            return FALSE;
+        bcopy(&page[offset], buf, n);
+    }
+    return TRUE;
+}
+
+bool
+AddrSpace::CopyOut(char *buf, int addr, int size)
+{
+    int offset, n;
+    char *page;
+
+    if (addr < 0 || size < 0)
+        return FALSE;
+    if (size == 0)
+        return TRUE;
+    if (!Prefault(addr, size))
+        return FALSE;
+    for (; size > 0; addr += n, buf += n, size -= n) {
+        offset = addr % PageSize;
+        n = min(size, PageSize - offset);
+        page = UserPage(addr / PageSize, TRUE);
+        if (page == NULL)
+            return FALSE;
+        bcopy(buf, &page[offset], n);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+//  Copy the null-terminated string at user address "addr" into "buf", 
+//  which holds "size" bytes.  The string is scanned for its end a 
+//  page at a time.  Return its length, or -1 if it runs off the 
+//  address space or does not fit in "buf" (with its '\0').
+//----------------------------------------------------------------------
+
+int
+AddrSpace::CopyInString(int addr, char *buf, int size)
+{
+    int length = 0, offset, n;
+    char *page, *end;
+
+    if (addr < 0)
+        return -1;
+    while (length < size) {
+        offset = addr % PageSize;
+        n = min(size - length, PageSize - offset);
+        page = UserPage(addr / PageSize, FALSE);
+        if (page == NULL)
+            return -1;
+        end = (char *) memchr(&page[offset], '\0', n);
+        if (end != NULL) {
+            n = end - &page[offset] + 1;
+            bcopy(&page[offset], &buf[length], n);
+            return length + n - 1;
+        }
+        bcopy(&page[offset], &buf[length], n);
+        addr += n;
+        length += n;
+    }
+    return -1;                  // too long
+}
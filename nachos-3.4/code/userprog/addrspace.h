@@ -16,8 +16,45 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "noff.h"
+#include "filetable.h"
+#include "imagecache.h"
+#include "bitmap.h"
+#include "stats.h"
 
-#define UserStackSize   1024  // increase this as necessary!
+class IoContext;
+
+// A file mapped into an address space with Mmap: "numPages" pages 
+// from "start" hold "length" bytes of "file", from "offset" on.
+
+class Mapping {
+  public:
+    int start;            // first virtual page
+    int numPages;
+    int fd;               // descriptor it was mapped through
+    OpenFile *file;
+    int offset;           // where in the file the mapping starts
+    int length;           // bytes of the file mapped
+    Mapping *next;        // mappings, highest first
+};
+
+#define DefaultUserStackSize   1024  // increase this as necessary!
+#define MaxPrefetchStride   8   // larger fault strides look random
+#define WorkingSetWindow    1000    // ticks a page stays in the 
+                            // working set after its last use
+#define MaxUserThreads  8   // threads that may share an address space, 
+                            // each with a stack of UserStackSize
+#define LinearGapPages  256 // pages left between the image and the 
+                            // stacks for the heap and mapped files, 
+                            // with a linear page table
+#define MinResidentLimit 4  // smallest resident limit a program may 
+                            // set: an instruction, its data, and a
+                            // system call buffer must fit
+#define UserSpaceTop    0x01000000  // top of the stack when the page 
+                            // table is sparse (radix or hashed); 
+                            // the heap grows up towards it
+
+extern int UserStackSize;   // bytes of stack for each program; set 
+                            // with -us or a -cf config file
 
 class AddrSpace {
   public:
@@ -28,13 +65,106 @@ class AddrSpace {
 
     void InitRegisters();   // Initialize user-level CPU registers,
           // before jumping to user code
+    void InitThreadRegisters(int func, int slot);
+          // Likewise, for a thread made by Fork
+          // to run "func" on stack "slot"
+
+    int AllocateStack();    // Reserve a stack for a new thread; 
+          // return its slot, or -1
+    void FreeStack(int slot);    // Give back a thread's stack
+    int StackTop(int slot);      // Highest address of stack "slot"
+
+    int Mmap(int fd, int offset, int length);
+          // Map part of open file "fd"; return
+          // its address, or -1
+    bool Munmap(int addr);       // Unmap the mapping at "addr", writing
+          // its dirty pages back to the file
+    Mapping *FindMapping(int vpn);
+          // The mapping "vpn" is in, or NULL
 
     void SaveState();     // Save/restore address space-specific
     void RestoreState();    // info on a context switch 
 
     
-    TranslationEntry *pageTable;  
-    unsigned int numPages;    
+    bool IsSharedCode(int vpn);  // Does page "vpn" hold only code, 
+          // and so can be shared with other 
+          // spaces running the same program?
+    bool IsValidPage(int vpn);   // Is "vpn" in the image, the heap
+          // or the stack?
+    int Sbrk(int increment);     // Move the end of the heap; return
+          // the old end, or -1
+
+    void ReadIn(TranslationEntry *entry, int ppn);
+          // Fill frame "ppn" with the saved
+          // contents of the page, or zeroes
+    void WriteBack(TranslationEntry *entry, int ppn);
+          // Save frame "ppn" to the swap file
+    void ReleaseFrame(TranslationEntry *entry);
+          // Give back the frame of a page
+    int MapFloor();       // Lowest page of the mappings and stacks:
+          // the heap may grow up to it
+
+    void SetExecName(char *name);
+          // Remember the executable's name, so
+          // that Checkpoint can record it
+    void GetUsage(Usage *total);
+          // Resources used by the process: its
+          // exited threads plus its running ones
+    bool AtResidentLimit(int extra);
+          // Would "extra" more resident pages 
+          // reach the resident limit?
+
+    int NoteFault(int vpn, int *stride);
+          // Track the fault pattern; return how 
+          // many pages to read ahead, and the stride
+    int WorkingSetSize();   // Resident pages used in the last
+          // WorkingSetWindow ticks
+
+    bool CopyIn(int addr, char *buf, int size);
+    bool CopyOut(char *buf, int addr, int size);
+          // Move a system call's buffer between
+          // user memory and the kernel, a page 
+          // at a time; FALSE if it is not all 
+          // in the address space
+    int CopyInString(int addr, char *buf, int size);
+          // Copy in a null-terminated string; 
+          // return its length, or -1
+    char *UserPage(int vpn, bool writing);
+          // Where page "vpn" is in main memory,
+          // paged in if need be
+    bool Prefault(int addr, int size);
+          // Page in a whole user buffer at once
+
+    PageTable *pageTable;  
+    unsigned int numPages;    // pages up to the top of the stack
+    int stackPages;       // pages of each stack; stack slot 0 is just 
+                          // below numPages, slot 1 below that, ...
+    BitMap *stackMap;     // stack slots in use
+    int numThreads;       // threads running in the space
+    int refCount;         // threads pointing to it, running or not
+    int heapStart;        // end of the program image, in bytes
+    int brk;              // current end of the heap, in bytes
+    int nextSwapPage;     // next free page of the swap file
+
+    int lastFaultPage;    // last page faulted (or prefetched) along 
+                          // the current pattern
+    int faultStride;      // distance between the last two faults
+    int prefetchWindow;   // pages to read ahead; grows while the 
+                          // pattern holds
+    int asid;             // tags this space's TLB entries
+    int codeKey;          // identifies the executable's image in the
+                          // page cache
+    int sharedCodePages;  // pages [0, sharedCodePages) are pure code
+    FileTable *fileTable; // files opened by the program
+    IoContext *io;        // its asynchronous I/O ring, if any
+    Mapping *mappings;    // files mapped with Mmap, highest first
+    ExecImage *image;     // the executable, parsed and read
+    char *execName;       // ... and its file name, or NULL
+    int pid;              // SpaceId in the process table, or -1
+    Usage usage;          // counts of its exited threads, and its 
+                          // resident set
+    int cpuLimit;         // ticks it may use, or 0 for no limit
+    int residentLimit;    // pages it may have in memory, or 0
     
           // address space
   //public:
@@ -94,11 +94,16 @@ BitMap::Test(int which)
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
-	}
+    for (int w = 0; w < numWords; w++) {
+	if (map[w] == ~0U)
+	    continue;			// a whole word in use; skip it
+	for (int i = w * BitsInWord; i < numBits; i++)
+	    if (!Test(i)) {
+		Mark(i);
+		return i;
+	    }
+	break;
+    }
     return -1;
 }
 
@@ -111,13 +116,65 @@ BitMap::Find()
 int 
 BitMap::NumClear() 
 {
-    int count = 0;
+    int count = numBits;
 
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
+    for (int w = 0; w < numWords; w++)
+	for (unsigned int bits = map[w]; bits != 0; bits &= bits - 1)
+	    count--;			// one set bit fewer each time
     return count;
 }
 
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Look for a run of "want" clear bits, beginning the search at bit
+//	"from" and wrapping around at the end of the map (runs do not
+//	wrap).  Whole words are dealt with at once where possible: a
+//	word with every bit set ends the current run, and a word with
+//	every bit clear extends it by BitsInWord.
+//
+//	Return the length of the first run of "want" bits, or of the 
+//	longest run if there is none that long, and set "*start" to its 
+//	first bit.  Return 0 if every bit is set.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int want, int from, int *start)
+{
+    int best = 0, run = 0, i = from, scanned = 0;
+
+    *start = -1;
+    while (scanned < numBits) {
+	if (i == numBits) {		// wrap; a run cannot continue
+	    i = 0;
+	    run = 0;
+	}
+	if (i % BitsInWord == 0 && i + BitsInWord <= numBits
+			&& (map[i / BitsInWord] == ~0U 
+			    || map[i / BitsInWord] == 0)) {
+	    if (map[i / BitsInWord] == ~0U)
+		run = 0;
+	    else
+		run += BitsInWord;
+	    i += BitsInWord;
+	    scanned += BitsInWord;
+	} else {
+	    if (Test(i))
+		run = 0;
+	    else
+		run++;
+	    i++;
+	    scanned++;
+	}
+	if (run > best) {
+	    best = run;
+	    *start = i - run;
+	    if (best >= want)
+		return want;
+	}
+    }
+    return best;
+}
+
 //----------------------------------------------------------------------
 // BitMap::Print
 // 	Print the contents of the bitmap, for debugging.
@@ -44,6 +44,13 @@ class BitMap {
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
     int NumClear();		// Return the number of clear bits
+    int FindRun(int want, int from, int *start);
+				// Look for "want" consecutive clear bits,
+				// starting at bit "from" and wrapping
+				// around; return the length of the run
+				// found (at most "want", the longest one
+				// if none is that long) and set "*start".
+				// The bits are not set.
 
     void Print();		// Print contents of bitmap
     
@@ -52,7 +59,7 @@ class BitMap {
     void FetchFrom(OpenFile *file); 	// fetch contents from disk 
     void WriteBack(OpenFile *file); 	// write contents to disk
 
-  private:
+  protected:
     int numBits;			// number of bits in the bitmap
     int numWords;			// number of words of bitmap storage
 					// (rounded up if numBits is not a
@@ -0,0 +1,233 @@
+// checkpoint.cc
+//	Routines to save a user program to a file, and to restore it.
+//	See checkpoint.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "checkpoint.h"
+
+// What the Mapcar helper below collects: the pages to save.
+
+class SavedPages {
+  public:
+    AddrSpace *space;
+    int *vpns;				// NULL to count them only
+    int count;
+};
+
+//----------------------------------------------------------------------
+// NoteWrittenPage
+// 	Mapcar helper for SaveCheckpoint: note the page of "entry" if it
+//	may differ from what the executable would give -- it has a copy
+//	in the swap file, or has been written since it was loaded.  Pure
+//	code pages are read-only, and never do.
+//----------------------------------------------------------------------
+
+static void
+NoteWrittenPage(TranslationEntry *entry, void *arg)
+{
+    SavedPages *saved = (SavedPages *) arg;
+
+    if (saved->space->IsSharedCode(entry->virtualPage))
+	return;
+    if (entry->backingPage != -1 || (entry->valid && (entry->dirty
+		|| machine->physPageTable[entry->physicalPage].dirty))) {
+	if (saved->vpns != NULL)
+	    saved->vpns[saved->count] = entry->virtualPage;
+	saved->count++;
+    }
+}
+
+//----------------------------------------------------------------------
+// CanSave
+// 	Return TRUE if nothing of "space" lives outside what a checkpoint
+//	holds: one thread, and no open file, mapping or I/O ring.
+//----------------------------------------------------------------------
+
+static bool
+CanSave(AddrSpace *space)
+{
+    if (space->numThreads != 1 || space->mappings != NULL
+	    || space->io != NULL || space->execName == NULL
+	    || strlen(space->execName) >= MaxExecName)
+	return FALSE;
+    for (int fd = 0; fd < MaxOpenFiles; fd++) {
+	FileTableEntry *entry = space->fileTable->Get(fd);
+	if (entry != NULL && entry->file != NULL)
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SaveCheckpoint
+// 	Save the program of the current thread, which is in the
+//	Checkpoint system call, to the file "name".  The saved registers
+//	are the ones it returns to, except that the call returns 1: the
+//	program can tell that it is running again from the checkpoint.
+//
+//	The TLB entries of the space are flushed first, so that the page
+//	table has every dirty bit.  A page is read from memory if it is
+//	resident when its turn comes, otherwise from the swap file: the
+//	writes may block, and meanwhile other programs may evict it.
+//
+//	Return FALSE if the program cannot be saved, or the file cannot
+//	be written.
+//----------------------------------------------------------------------
+
+bool
+SaveCheckpoint(char *name)
+{
+    AddrSpace *space = currentThread->space;
+    CheckpointHeader *hdr;
+    SavedPages saved;
+    OpenFile *file;
+    char *page;
+    bool ok;
+    int i;
+
+    if (!CanSave(space))
+	return FALSE;
+    machine->FlushASID(space->asid);
+    saved.space = space;
+    saved.vpns = NULL;
+    saved.count = 0;
+    space->pageTable->Mapcar(NoteWrittenPage, &saved);
+    saved.vpns = new int[max(saved.count, 1)];
+    saved.count = 0;
+    space->pageTable->Mapcar(NoteWrittenPage, &saved);
+
+    int recordSize = sizeof(int) + PageSize;
+    if (!fileSystem->Create(name, sizeof(CheckpointHeader)
+				+ saved.count * recordSize)
+	    || (file = fileSystem->Open(name)) == NULL) {
+	delete [] saved.vpns;
+	return FALSE;
+    }
+
+    hdr = new CheckpointHeader;
+    hdr->magic = CheckpointMagic;
+    hdr->pageSize = PageSize;
+    hdr->fileLength = space->image->fileLength;
+    strcpy(hdr->execName, space->execName);
+    for (i = 0; i < NumTotalRegs; i++)
+	hdr->registers[i] = machine->ReadRegister(i);
+    hdr->registers[2] = 1;		// Checkpoint's result, once restored
+    hdr->brk = space->brk;
+    hdr->stackSlot = currentThread->stackSlot;
+    hdr->cpuLimit = space->cpuLimit;
+    hdr->residentLimit = space->residentLimit;
+    hdr->numSaved = saved.count;
+    hdr->stats = *stats;
+    space->GetUsage(&hdr->usage);
+    ok = file->WriteAt((char *) hdr, sizeof(CheckpointHeader), 0)
+		== (int) sizeof(CheckpointHeader);
+
+    page = new char[recordSize];
+    for (i = 0; ok && i < saved.count; i++) {
+	TranslationEntry *entry = space->pageTable->Lookup(saved.vpns[i]);
+	*(int *) page = saved.vpns[i];
+	if (entry->valid)
+	    bcopy(&machine->mainMemory[entry->physicalPage * PageSize],
+		  page + sizeof(int), PageSize);
+	else
+	    space->vaSpace->ReadAt(page + sizeof(int), PageSize,
+				   entry->backingPage * PageSize);
+	ok = file->WriteAt(page, recordSize, sizeof(CheckpointHeader)
+				+ i * recordSize) == recordSize;
+    }
+    DEBUG('a', "Checkpoint %s: %d pages of %s\n", name, saved.count,
+	  space->execName);
+    delete [] page;
+    delete hdr;
+    delete file;
+    delete [] saved.vpns;
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// RestoreCheckpoint
+// 	Rebuild the program saved in the file "name" for the current
+//	thread: a fresh address space for the executable, with the saved
+//	heap and stack, and the saved pages on top.  Those that are
+//	resident already (loaded with the code) are overwritten in place;
+//	the others go to the swap file, to be faulted in when touched, as
+//	if they had been paged out.  The statistics and usage go on from
+//	where they were, though the clock is never set back.
+//
+//	The registers are loaded into the machine: the caller need only
+//	call Machine::Run.  Return FALSE if "name" is not a checkpoint
+//	this Nachos can restore.
+//----------------------------------------------------------------------
+
+bool
+RestoreCheckpoint(char *name)
+{
+    OpenFile *file = fileSystem->Open(name);
+    CheckpointHeader *hdr = new CheckpointHeader;
+    OpenFile *executable = NULL;
+    AddrSpace *space;
+    char *page;
+    int i;
+
+    if (file == NULL || file->ReadAt((char *) hdr, sizeof(CheckpointHeader),
+				      0) != (int) sizeof(CheckpointHeader)
+	    || hdr->magic != CheckpointMagic || hdr->pageSize != PageSize
+	    || (executable = fileSystem->Open(hdr->execName)) == NULL
+	    || executable->Length() != hdr->fileLength) {
+	delete executable;
+	delete hdr;
+	delete file;
+	return FALSE;
+    }
+    space = new AddrSpace(executable);
+    delete executable;
+    space->SetExecName(hdr->execName);
+    space->pid = processTable->Add(-1);
+    processTable->Attach(space->pid, space);
+    space->brk = hdr->brk;
+    space->stackMap->Clear(0);
+    space->stackMap->Mark(hdr->stackSlot);
+    space->cpuLimit = hdr->cpuLimit;
+    space->residentLimit = hdr->residentLimit;
+    space->usage.Add(&hdr->usage);
+    currentThread->space = space;
+    currentThread->stackSlot = hdr->stackSlot;
+
+    int recordSize = sizeof(int) + PageSize;
+    page = new char[recordSize];
+    for (i = 0; i < hdr->numSaved; i++) {
+	file->ReadAt(page, recordSize, sizeof(CheckpointHeader)
+				+ i * recordSize);
+	TranslationEntry *entry = space->pageTable->Create(*(int *) page);
+	if (entry->valid) {
+	    bcopy(page + sizeof(int),
+		  &machine->mainMemory[entry->physicalPage * PageSize],
+		  PageSize);
+	    entry->dirty = TRUE;
+	    machine->physPageTable[entry->physicalPage].dirty = TRUE;
+	} else {
+	    if (entry->backingPage == -1)
+		entry->backingPage = space->nextSwapPage++;
+	    space->vaSpace->WriteAt(page + sizeof(int), PageSize,
+				    entry->backingPage * PageSize);
+	}
+    }
+    delete [] page;
+
+    hdr->stats.totalTicks = max(hdr->stats.totalTicks, stats->totalTicks);
+    *stats = hdr->stats;
+    space->RestoreState();
+    for (i = 0; i < NumTotalRegs; i++)
+	machine->WriteRegister(i, hdr->registers[i]);
+    machine->llBit = FALSE;
+    DEBUG('a', "Restored %s from %s: %d pages\n", hdr->execName, name,
+	  hdr->numSaved);
+    delete hdr;
+    delete file;
+    return TRUE;
+}
@@ -0,0 +1,59 @@
+// checkpoint.h
+//	Data structures to save a running user program to a file, and to
+//	start it again from there in a later run of Nachos.
+//
+//	A checkpoint holds what the executable cannot give back: the
+//	user registers, the heap break and stack of the address space,
+//	every page the program has written -- whether it is in memory or
+//	in the swap file -- and the statistics and usage counted so far.
+//	Code, and pages never written, are not saved; they are loaded
+//	from the executable again, so it must not change in between.
+//
+//	The file is a CheckpointHeader, then "numSaved" records of a
+//	virtual page number followed by the page.  It is only meant to be
+//	read back by the same Nachos binary, with the same page size.
+//
+//	Only a simple program can be saved: a single thread, with no file
+//	open but the console, no mapped files and no I/O ring.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "stats.h"
+
+#define CheckpointMagic	0x4e43504b	// identifies a checkpoint file
+#define MaxExecName	256		// longest executable name saved
+
+class CheckpointHeader {
+  public:
+    int magic;				// CheckpointMagic
+    int pageSize;			// PageSize when it was saved
+    int fileLength;			// size of the executable, to catch
+					// one that has changed
+    char execName[MaxExecName];		// the executable
+    int registers[NumTotalRegs];	// user registers, just after the
+					// Checkpoint system call
+    int brk;				// end of the heap
+    int stackSlot;			// stack of the thread
+    int cpuLimit;			// limits (cf. SetLimit)
+    int residentLimit;
+    int numSaved;			// pages following the header
+    Statistics stats;			// the machine's, when saved
+    Usage usage;			// the program's, when saved
+};
+
+extern bool SaveCheckpoint(char *name);
+				// Save the program of the current thread
+				// to file "name"; FALSE if it cannot be
+				// saved
+extern bool RestoreCheckpoint(char *name);
+				// Make the current thread the program
+				// saved in "name", ready to Run
+
+#endif // CHECKPOINT_H
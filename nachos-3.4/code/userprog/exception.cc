@@ -4,8 +4,10 @@
 //  transfer back to here from user code:
 //
 //  syscall -- The user code explicitly requests to call a procedure
-//  in the Nachos kernel.  Right now, the only function we support is
-//  "Halt".
+//  in the Nachos kernel: Halt, Exit, Exec, Join, the file system 
+//  calls (Create, Open, Read, Write, Close), Fork, Yield, FutexWait, 
+//  FutexWake, IoEnter, Mmap, Munmap, GetUsage, SetLimit, Checkpoint, 
+//  Print and Sbrk.
 //
 //  exceptions -- The user code does something that the CPU can't handle.
 //  For instance, accessing memory that doesn't exist, arithmetic errors,
@@ -14,9 +16,6 @@
 //  Interrupts (which can also cause control to transfer from user
 //  code into the Nachos kernel) are handled elsewhere.
 //
-// For now, this only handles the Halt() system call.
-// Everything else core dumps.
-//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -24,6 +23,393 @@
 #include "copyright.h"
 #include "system.h"
 #include "syscall.h"
+#include "checkpoint.h"
+
+#define MaxNameLength   256     // longest file name a program may pass
+#define MaxIOChunk      (16 * PageSize)
+                                // most bytes a Read or Write moves 
+                                // through the kernel at a time
+
+//----------------------------------------------------------------------
+// AdvancePC
+//  Step the user program past the syscall instruction, so that it 
+//  does not make the same system call again when it resumes.
+//----------------------------------------------------------------------
+
+static void
+AdvancePC()
+{
+    int pc = machine->ReadRegister(NextPCReg);
+
+    machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+    machine->WriteRegister(PCReg, pc);
+    machine->WriteRegister(NextPCReg, pc + 4);
+}
+
+//----------------------------------------------------------------------
+// SysCreate/SysOpen/SysClose
+//  The file system calls that take a name or a descriptor.  Return 
+//  the value for r2: 0 (or the new descriptor) if all went well, -1 
+//  if not.
+//----------------------------------------------------------------------
+
+static int
+SysCreate(int nameAddr)
+{
+    char name[MaxNameLength];
+
+    if (currentThread->space->CopyInString(nameAddr, name, MaxNameLength) < 0)
+        return -1;
+    return fileSystem->Create(name, 0) ? 0 : -1;
+}
+
+static int
+SysOpen(int nameAddr)
+{
+    char name[MaxNameLength];
+    OpenFile *file;
+    int fd;
+
+    if (currentThread->space->CopyInString(nameAddr, name, MaxNameLength) < 0)
+        return -1;
+    file = fileSystem->Open(name);
+    if (file == NULL)
+        return -1;
+    fd = currentThread->space->fileTable->Add(file);
+    if (fd == -1)
+        delete file;                    // too many open files
+    return fd;
+}
+
+static int
+SysClose(int fd)
+{
+    return currentThread->space->fileTable->Remove(fd) ? 0 : -1;
+}
+
+//----------------------------------------------------------------------
+// SysRead/SysWrite
+//  Move "size" bytes between the user buffer at "addr" and open file 
+//  "fd", starting at the descriptor's position.  A file is read or 
+//  written with ReadAt/WriteAt, in pieces of up to MaxIOChunk bytes, 
+//  each copied between user memory and the kernel a page at a time 
+//  (cf. AddrSpace::CopyIn).  Reading the console returns at the end 
+//  of a line.
+//
+//  Return the number of bytes read or written, or -1 if the 
+//  descriptor is not open or the buffer is not in the address space.
+//----------------------------------------------------------------------
+
+static int
+SysRead(int addr, int size, int fd)
+{
+    AddrSpace *space = currentThread->space;
+    FileTableEntry *entry = space->fileTable->Get(fd);
+    int done = 0, chunk, n;
+    char *buf;
+
+    if (entry == NULL || size < 0)
+        return -1;
+    buf = new char[max(min(size, MaxIOChunk), 1)];
+    if (entry->file == NULL) {          // the console
+        n = UserConsole()->Read(buf, min(size, MaxIOChunk));
+        done = space->CopyOut(buf, addr, n) ? n : -1;
+    } else {
+        while (done < size) {
+            chunk = min(size - done, MaxIOChunk);
+            n = entry->file->ReadAt(buf, chunk, entry->position);
+            if (n <= 0)
+                break;                  // end of file
+            if (!space->CopyOut(buf, addr + done, n)) {
+                done = -1;
+                break;
+            }
+            entry->position += n;
+            done += n;
+            if (n < chunk)
+                break;
+        }
+    }
+    delete [] buf;
+    return done;
+}
+
+static int
+SysWrite(int addr, int size, int fd)
+{
+    AddrSpace *space = currentThread->space;
+    FileTableEntry *entry = space->fileTable->Get(fd);
+    int done = 0, chunk, n;
+    char *buf;
+
+    if (entry == NULL || size < 0)
+        return -1;
+    buf = new char[max(min(size, MaxIOChunk), 1)];
+    while (done < size) {
+        chunk = min(size - done, MaxIOChunk);
+        if (!space->CopyIn(addr + done, buf, chunk)) {
+            done = -1;
+            break;
+        }
+        if (entry->file == NULL) {      // the console
+            UserConsole()->Write(buf, chunk);
+            n = chunk;
+        } else {
+            n = entry->file->WriteAt(buf, chunk, entry->position);
+            entry->position += n;
+        }
+        done += n;
+        if (n < chunk)
+            break;                      // disk full
+    }
+    delete [] buf;
+    return done;
+}
+
+//----------------------------------------------------------------------
+// ExecStart
+//  The first thing a thread made by Exec does: start running its 
+//  program, whose address space the parent has already set up.
+//----------------------------------------------------------------------
+
+static void
+ExecStart(int arg)
+{
+    currentThread->space->InitRegisters();
+    currentThread->space->RestoreState();
+    machine->Run();
+    ASSERT(FALSE);                      // the program ends with Exit
+}
+
+//----------------------------------------------------------------------
+// SysExec
+//  Start the program in the file named at "nameAddr" in a new thread 
+//  and address space.  The executable is parsed and read only if it 
+//  is not in the image cache; its code pages are shared with any 
+//  other program running it.  Return the new program's SpaceId, or 
+//  -1 if the file cannot be opened or there are too many programs.  
+//  The new program inherits our limits (cf. SysSetLimit).
+//----------------------------------------------------------------------
+
+static int
+SysExec(int nameAddr)
+{
+    char name[MaxNameLength];
+    OpenFile *executable;
+    AddrSpace *space;
+    Thread *thread;
+    int pid;
+
+    if (currentThread->space->CopyInString(nameAddr, name, MaxNameLength) < 0)
+        return -1;
+    executable = fileSystem->Open(name);
+    if (executable == NULL)
+        return -1;
+    pid = processTable->Add(currentThread->space->pid);
+    if (pid == -1) {
+        delete executable;
+        return -1;
+    }
+    space = new AddrSpace(executable);
+    space->pid = pid;
+    space->SetExecName(name);
+    space->cpuLimit = currentThread->space->cpuLimit;
+    space->residentLimit = currentThread->space->residentLimit;
+    processTable->Attach(pid, space);
+    delete executable;
+
+    char *threadName = new char[strlen(name) + 1];
+    strcpy(threadName, name);
+    thread = new Thread(threadName);
+    thread->space = space;
+    DEBUG('a', "Exec %s as SpaceId %d\n", name, pid);
+    thread->Fork(ExecStart, 0);
+    return pid;
+}
+
+//----------------------------------------------------------------------
+// SysJoin
+//  Wait for the program "pid", which we must have Exec'ed, to exit. 
+//  Return its exit status, or -1 if it is not our child.
+//----------------------------------------------------------------------
+
+static int
+SysJoin(int pid)
+{
+    int status;
+
+    if (!processTable->Join(currentThread->space->pid, pid, &status))
+        return -1;
+    return status;
+}
+
+//----------------------------------------------------------------------
+// ForkStart
+//  The first thing a thread made by Fork does: jump to the user 
+//  procedure "func", on its own stack, in the address space it shares 
+//  with the thread that forked it.
+//----------------------------------------------------------------------
+
+static void
+ForkStart(int func)
+{
+    currentThread->space->InitThreadRegisters(func, currentThread->stackSlot);
+    currentThread->space->RestoreState();
+    machine->Run();
+    ASSERT(FALSE);                      // the thread ends with Exit
+}
+
+//----------------------------------------------------------------------
+// SysFork
+//  Start a thread running the user procedure at "func" in the 
+//  current address space.  Nothing is copied: the new thread just 
+//  gets a stack slot of its own, and its own registers.  Return 0, 
+//  or -1 if the address space has MaxUserThreads threads already.
+//----------------------------------------------------------------------
+
+static int
+SysFork(int func)
+{
+    AddrSpace *space = currentThread->space;
+    int slot = space->AllocateStack();
+    Thread *thread;
+
+    if (slot == -1)
+        return -1;
+    thread = new Thread("user thread");
+    thread->space = space;
+    thread->stackSlot = slot;
+    space->refCount++;
+    space->numThreads++;
+    DEBUG('a', "Fork 0x%x on stack %d\n", func, slot);
+    thread->Fork(ForkStart, func);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// ExitProcess
+//  The running thread is done.  Its stack goes back to the address 
+//  space; if it was the last thread there, the program is done, and 
+//  its parent is told "status".
+//----------------------------------------------------------------------
+
+static void
+ExitProcess(int status)
+{
+    AddrSpace *space = currentThread->space;
+
+    space->FreeStack(currentThread->stackSlot);
+    if (--space->numThreads == 0 && space->pid != -1)
+        processTable->Exit(space->pid, status);
+    currentThread->Finish();
+}
+
+//----------------------------------------------------------------------
+// SysGetUsage
+//  Copy out to "addr" the resources used by "who": USAGE_PROCESS for 
+//  our own program, USAGE_THREAD for the calling thread alone, or 
+//  the SpaceId of another program, running or exited but not yet 
+//  joined.  A Usage is all ints, so it goes out as the ProcessUsage 
+//  of syscall.h one word at a time.  Return 0, or -1 if there is no 
+//  such program or "addr" is not a valid buffer.
+//----------------------------------------------------------------------
+
+static int
+SysGetUsage(int who, int addr)
+{
+    Usage usage;
+    int *words = (int *) &usage;
+
+    if (who == USAGE_THREAD)
+        usage = currentThread->usage;
+    else if (who == USAGE_PROCESS) {
+        currentThread->space->GetUsage(&usage);
+        usage.workingSet = currentThread->space->WorkingSetSize();
+    } else if (!processTable->GetUsage(who, &usage))
+        return -1;
+    for (unsigned int i = 0; i < sizeof(Usage) / sizeof(int); i++)
+        words[i] = WordToMachine(words[i]);
+    if (!currentThread->space->CopyOut((char *) &usage, addr, sizeof(Usage)))
+        return -1;
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// SysSetLimit
+//  Limit a resource of our program, and of the programs it Exec's 
+//  from now on; 0 removes the limit.  LIMIT_CPU is in ticks of user 
+//  and system time: the program is stopped at the end of the time 
+//  slice in which it goes over (cf. EnforceCpuLimit).  LIMIT_RESIDENT 
+//  is in pages, at least MinResidentLimit: at the limit, the pager 
+//  replaces the program's own pages rather than take more frames 
+//  (cf. Machine::AllocateFrame).  Return the old limit, or -1.
+//----------------------------------------------------------------------
+
+static int
+SysSetLimit(int resource, int value)
+{
+    AddrSpace *space = currentThread->space;
+    int old;
+
+    if (value < 0)
+        return -1;
+    switch (resource) {
+      case LIMIT_CPU:
+        old = space->cpuLimit;
+        space->cpuLimit = value;
+        return old;
+      case LIMIT_RESIDENT:
+        if (value > 0 && value < MinResidentLimit)
+            return -1;
+        old = space->residentLimit;
+        space->residentLimit = value;
+        return old;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SysCheckpoint
+//  Save the program to the file named at "nameAddr", to be started 
+//  again with "nachos -rx".  The PC has already been advanced, so 
+//  that the restored program resumes after the call.  Return 0, or 
+//  -1 if it cannot be saved.  (The restored program sees 1.)
+//----------------------------------------------------------------------
+
+static int
+SysCheckpoint(int nameAddr)
+{
+    char name[MaxNameLength];
+
+    if (currentThread->space->CopyInString(nameAddr, name, MaxNameLength) < 0)
+        return -1;
+    return SaveCheckpoint(name) ? 0 : -1;
+}
+
+//----------------------------------------------------------------------
+// EnforceCpuLimit
+//  Called each time a user thread is preempted at the end of its time 
+//  slice, before it yields: if its program has used more than its CPU 
+//  limit, stop the thread then, rather than give it a place in the 
+//  ready queue.  Its other threads are stopped as they are preempted 
+//  in turn.
+//----------------------------------------------------------------------
+
+void
+EnforceCpuLimit()
+{
+    AddrSpace *space = currentThread->space;
+    Usage usage;
+
+    if (space == NULL || space->cpuLimit == 0)
+        return;
+    space->GetUsage(&usage);
+    if (usage.userTicks + usage.systemTicks > space->cpuLimit) {
+        printf("Thread %d: CPU limit exceeded\n", 
+               currentThread->GetThreadID());
+        ExitProcess(-1);
+    }
+}
 
 //----------------------------------------------------------------------
 // ExceptionHandler
@@ -53,21 +439,114 @@ ExceptionHandler(ExceptionType which)
 {
     int type = machine->ReadRegister(2);
 
+    if (which == SyscallException && type >= 0 && type < NumSyscallCodes)
+        currentThread->usage.syscalls[type]++;
     if ((which == SyscallException) && (type == SC_Halt)) {
   DEBUG('a', "Shutdown, initiated by user program.\n");
+    if (synchConsole != NULL)
+        synchConsole->Flush();      // output still queued
     interrupt->Halt();
     } else if ((which == SyscallException) && (type == SC_Exit)) {
         int exitStatus = machine->ReadRegister(4);
         printf("Thread %d Exit %d\n", currentThread->GetThreadID(), exitStatus);
-        currentThread->Finish();
+        ExitProcess(exitStatus);
+    } else if ((which == SyscallException) && (type == SC_Exec)) {
+          machine->WriteRegister(2, SysExec(machine->ReadRegister(4)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Join)) {
+          machine->WriteRegister(2, SysJoin(machine->ReadRegister(4)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Fork)) {
+          machine->WriteRegister(2, SysFork(machine->ReadRegister(4)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Yield)) {
+          AdvancePC();
+          currentThread->Yield();
+    } else if ((which == SyscallException) && (type == SC_FutexWait)) {
+          AddrSpace *space = currentThread->space;
+          AdvancePC();
+          machine->WriteRegister(2, futexTable->Wait(space, 
+                machine->ReadRegister(4), machine->ReadRegister(5)));
+    } else if ((which == SyscallException) && (type == SC_FutexWake)) {
+          machine->WriteRegister(2, futexTable->Wake(currentThread->space, 
+                machine->ReadRegister(4), machine->ReadRegister(5)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_IoEnter)) {
+          AddrSpace *space = currentThread->space;
+          int ring = machine->ReadRegister(4);
+          int toSubmit = machine->ReadRegister(5);
+          int minComplete = machine->ReadRegister(6);
+          AdvancePC();
+          machine->WriteRegister(2, ioService->Enter(space, ring, toSubmit, 
+                minComplete));
+    } else if ((which == SyscallException) && (type == SC_Mmap)) {
+          machine->WriteRegister(2, currentThread->space->Mmap(
+                machine->ReadRegister(4), machine->ReadRegister(5), 
+                machine->ReadRegister(6)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Munmap)) {
+          bool ok = currentThread->space->Munmap(machine->ReadRegister(4));
+          machine->WriteRegister(2, ok ? 0 : -1);
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_GetUsage)) {
+          machine->WriteRegister(2, SysGetUsage(machine->ReadRegister(4), 
+                machine->ReadRegister(5)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_SetLimit)) {
+          machine->WriteRegister(2, SysSetLimit(machine->ReadRegister(4), 
+                machine->ReadRegister(5)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Checkpoint)) {
+          int nameAddr = machine->ReadRegister(4);
+          AdvancePC();
+          machine->WriteRegister(2, SysCheckpoint(nameAddr));
     } else if ((which == SyscallException) && (type == SC_Print)){
           int value = machine->ReadRegister(4);
           printf("The Value is %d\n", value);
-          
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Sbrk)) {
+          int increment = machine->ReadRegister(4);
+          machine->WriteRegister(2, currentThread->space->Sbrk(increment));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Create)) {
+          machine->WriteRegister(2, SysCreate(machine->ReadRegister(4)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Open)) {
+          machine->WriteRegister(2, SysOpen(machine->ReadRegister(4)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Read)) {
+          machine->WriteRegister(2, SysRead(machine->ReadRegister(4), 
+                machine->ReadRegister(5), machine->ReadRegister(6)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Write)) {
+          machine->WriteRegister(2, SysWrite(machine->ReadRegister(4), 
+                machine->ReadRegister(5), machine->ReadRegister(6)));
+          AdvancePC();
+    } else if ((which == SyscallException) && (type == SC_Close)) {
+          machine->WriteRegister(2, SysClose(machine->ReadRegister(4)));
+          AdvancePC();
     }
     else if (which == PageFaultException) {
               int vaddr = machine->ReadRegister(BadVAddrReg);
-              machine->LRUSwapTLB(vaddr);
+              if (!currentThread->space->IsValidPage((unsigned) vaddr / PageSize)) {
+                     printf("Thread %d: bad address 0x%x\n", 
+                            currentThread->GetThreadID(), vaddr);
+                     ExitProcess(-1);
+              }
+              if (machine->tlb != NULL)
+                     machine->LRUSwapTLB(vaddr);
+              else
+                     machine->AllocatePhysPage(vaddr);
+    }
+    else if (which == ReadOnlyException || which == AddressErrorException) {
+              // a store into (shared) code, or an unaligned or
+              // out-of-range reference: the program's fault, not ours
+              int vaddr = machine->ReadRegister(BadVAddrReg);
+              printf("Thread %d: %s at address 0x%x\n",
+                     currentThread->GetThreadID(),
+                     which == ReadOnlyException ? "write to read-only page"
+                                                : "address error", vaddr);
+              ExitProcess(-1);
     }
      else if (which == IllegalInstrException) {
               printf("IllegalInstrException Exception!\n");
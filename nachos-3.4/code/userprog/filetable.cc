@@ -0,0 +1,97 @@
+// filetable.cc
+//  Routines to manage the open files of a user program.  See
+//  filetable.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "syscall.h"
+#include "filetable.h"
+
+//----------------------------------------------------------------------
+// FileTable::FileTable
+//  Initialize a table with the console descriptors open, and every
+//  other one on the free list, lowest first.
+//----------------------------------------------------------------------
+
+FileTable::FileTable()
+{
+    for (int i = 0; i < MaxOpenFiles; i++) {
+        table[i].inUse = (i == ConsoleInput || i == ConsoleOutput);
+        table[i].file = NULL;
+        table[i].position = 0;
+        table[i].pending = 0;
+        table[i].nextFree = (i + 1 < MaxOpenFiles) ? i + 1 : -1;
+    }
+    freeList = ConsoleOutput + 1;
+}
+
+//----------------------------------------------------------------------
+// FileTable::~FileTable
+//  Close the files the program left open.
+//----------------------------------------------------------------------
+
+FileTable::~FileTable()
+{
+    for (int i = 0; i < MaxOpenFiles; i++)
+        if (table[i].inUse && table[i].file != NULL)
+            delete table[i].file;
+}
+
+//----------------------------------------------------------------------
+// FileTable::Add
+//  Take the descriptor at the head of the free list for "file".
+//----------------------------------------------------------------------
+
+int
+FileTable::Add(OpenFile *file)
+{
+    int fd = freeList;
+
+    if (fd == -1)
+        return -1;
+    freeList = table[fd].nextFree;
+    table[fd].inUse = TRUE;
+    table[fd].file = file;
+    table[fd].position = 0;
+    return fd;
+}
+
+//----------------------------------------------------------------------
+// FileTable::Get
+//  Return the slot of descriptor "fd", or NULL if it is not open.
+//----------------------------------------------------------------------
+
+FileTableEntry *
+FileTable::Get(int fd)
+{
+    if (fd < 0 || fd >= MaxOpenFiles || !table[fd].inUse)
+        return NULL;
+    return &table[fd];
+}
+
+//----------------------------------------------------------------------
+// FileTable::Remove
+//  Close descriptor "fd", and put it back on the free list.  A file 
+//  cannot be closed while asynchronous requests on it are pending, or 
+//  while it is mapped (cf. AddrSpace::Mmap).
+//----------------------------------------------------------------------
+
+bool
+FileTable::Remove(int fd)
+{
+    FileTableEntry *entry = Get(fd);
+
+    if (entry == NULL || entry->pending > 0)
+        return FALSE;
+    if (entry->file != NULL)
+        delete entry->file;
+    entry->inUse = FALSE;
+    entry->file = NULL;
+    entry->nextFree = freeList;
+    freeList = fd;
+    return TRUE;
+}
@@ -0,0 +1,55 @@
+// filetable.h
+//  Data structures for the open files of a user program.
+//
+//  Each address space has a table mapping the OpenFileId's handed
+//  out by the Open system call to Nachos OpenFile's.  Descriptors
+//  ConsoleInput and ConsoleOutput (0 and 1) stand for the console,
+//  and are open from the start.
+//
+//  The free descriptors are kept on a list threaded through the
+//  table, so that opening and closing a file take constant time.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FILETABLE_H
+#define FILETABLE_H
+
+#include "copyright.h"
+#include "openfile.h"
+
+#define MaxOpenFiles    16      // descriptors per address space
+
+// One slot of the table: an open file and the position the next
+// Read or Write on it starts from.
+
+class FileTableEntry {
+  public:
+    bool inUse;                 // is the descriptor open?
+    OpenFile *file;             // NULL for the console
+    int position;               // offset of the next Read/Write
+    int pending;                // asynchronous requests in progress,
+                                // and mappings of the file
+    int nextFree;               // next free slot, if not in use
+};
+
+class FileTable {
+  public:
+    FileTable();                // Only the console is open
+    ~FileTable();               // Close every open file
+
+    int Add(OpenFile *file);    // Give "file" a descriptor; return
+                                // it, or -1 if the table is full
+    FileTableEntry *Get(int fd);
+                                // The open descriptor "fd", or NULL
+    bool Remove(int fd);        // Close "fd"; FALSE if it is not open,
+                                // or has I/O pending (cf. ioring.h)
+                                // or is mapped
+
+  private:
+    FileTableEntry table[MaxOpenFiles];
+    int freeList;               // first free slot, or -1
+};
+
+#endif // FILETABLE_H
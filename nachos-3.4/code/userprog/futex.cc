@@ -0,0 +1,135 @@
+// futex.cc
+//	Routines to put user threads to sleep on a word of their memory,
+//	and to wake them.  See futex.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "futex.h"
+
+//----------------------------------------------------------------------
+// FutexTable::FutexTable
+// 	Initialize a table with nobody waiting.
+//----------------------------------------------------------------------
+
+FutexTable::FutexTable()
+{
+    for (int i = 0; i < FutexBuckets; i++)
+	buckets[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::~FutexTable
+// 	De-allocate the table.  Threads still waiting are not ours to
+//	delete.
+//----------------------------------------------------------------------
+
+FutexTable::~FutexTable()
+{
+    for (int i = 0; i < FutexBuckets; i++)
+	while (buckets[i] != NULL) {
+	    FutexWaiter *waiter = buckets[i];
+	    buckets[i] = waiter->next;
+	    delete waiter;
+	}
+}
+
+//----------------------------------------------------------------------
+// FutexTable::ReadWord
+// 	Fetch the word at "addr" in "space" into "value", but only if its
+//	page is in memory: with interrupts off we cannot wait for a page
+//	fault.  Return FALSE if it is not resident.
+//----------------------------------------------------------------------
+
+bool
+FutexTable::ReadWord(AddrSpace *space, int addr, int *value)
+{
+    TranslationEntry *entry = space->pageTable->Lookup(addr / PageSize);
+
+    if (entry == NULL || !entry->valid)
+	return FALSE;
+    *value = WordToHost(*(unsigned int *) &machine->mainMemory[
+		entry->physicalPage * PageSize + addr % PageSize]);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wait
+// 	Put the current thread to sleep on the word at "addr" in "space",
+//	unless it no longer holds "value" -- the lock it guards has been
+//	released since the thread saw it taken.
+//
+//	The check and going to sleep must be atomic with respect to a
+//	FutexWake, so both are done with interrupts off, as in
+//	Semaphore::P.  Faulting the page in cannot be, so that is done
+//	first, and the check is retried if the page was evicted again.
+//
+//	Returns 0 after being woken, -1 if the word did not hold "value"
+//	or is not a valid, aligned address.
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wait(AddrSpace *space, int addr, int value)
+{
+    int current, b = Hash(space, addr);
+    FutexWaiter *waiter, **pp;
+    char word[4];
+
+    if (addr < 0 || (addr & 0x3))
+	return -1;
+    for (;;) {
+	if (!space->CopyIn(addr, word, 4))	// fault it in
+	    return -1;
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	if (ReadWord(space, addr, &current)) {
+	    if (current != value) {
+		(void) interrupt->SetLevel(oldLevel);
+		return -1;
+	    }
+	    waiter = new FutexWaiter;
+	    waiter->space = space;
+	    waiter->addr = addr;
+	    waiter->thread = currentThread;
+	    waiter->next = NULL;
+	    for (pp = &buckets[b]; *pp != NULL; pp = &(*pp)->next)
+		;			// FIFO: wake in order of arrival
+	    *pp = waiter;
+	    DEBUG('a', "Thread %d waits on futex 0x%x\n",
+		  currentThread->GetThreadID(), addr);
+	    currentThread->Sleep();
+	    (void) interrupt->SetLevel(oldLevel);
+	    return 0;
+	}
+	(void) interrupt->SetLevel(oldLevel);
+    }
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wake
+// 	Wake up to "count" threads waiting on the word at "addr" in
+//	"space", first come first served.  Return the number woken.
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wake(AddrSpace *space, int addr, int count)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    FutexWaiter **pp = &buckets[Hash(space, addr)];
+    int woken = 0;
+
+    while (*pp != NULL && woken < count) {
+	FutexWaiter *waiter = *pp;
+	if (waiter->space == space && waiter->addr == addr) {
+	    *pp = waiter->next;
+	    scheduler->ReadyToRun(waiter->thread);
+	    delete waiter;
+	    woken++;
+	} else
+	    pp = &waiter->next;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return woken;
+}
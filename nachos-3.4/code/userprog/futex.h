@@ -0,0 +1,58 @@
+// futex.h
+//	Data structures for the FutexWait and FutexWake system calls.
+//
+//	User programs build their locks out of a word of their own memory
+//	and the LL/SC instructions (cf. CompareAndSwap in start.s): taking
+//	a free lock, and giving back one nobody waits for, never enter the
+//	kernel.  Only under contention does a thread call FutexWait, to
+//	sleep until the word changes, and the holder FutexWake, to wake it.
+//
+//	Waiting threads are kept on hash chains keyed by their address
+//	space and the virtual address of the word.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "copyright.h"
+#include "thread.h"
+
+#define FutexBuckets	32		// hash chains; a power of two
+
+// A thread asleep in FutexWait.
+
+class FutexWaiter {
+  public:
+    AddrSpace *space;			// the word waited on is at
+    int addr;				// "addr" in "space"
+    Thread *thread;
+    FutexWaiter *next;			// next waiter on the same chain
+};
+
+class FutexTable {
+  public:
+    FutexTable();
+    ~FutexTable();
+
+    int Wait(AddrSpace *space, int addr, int value);
+					// Sleep if the word at "addr" still
+					// holds "value"; return 0 once woken,
+					// -1 if the word had changed or
+					// is not in the address space
+    int Wake(AddrSpace *space, int addr, int count);
+					// Wake up to "count" waiters on
+					// "addr"; return how many
+
+  private:
+    int Hash(AddrSpace *space, int addr)
+	{ return ((unsigned) addr >> 2 ^ (unsigned) space) & (FutexBuckets - 1); }
+    bool ReadWord(AddrSpace *space, int addr, int *value);
+					// Fetch the word, if it is resident
+
+    FutexWaiter *buckets[FutexBuckets];
+};
+
+#endif // FUTEX_H
@@ -0,0 +1,200 @@
+// imagecache.cc
+//	Routines to cache parsed executables.  See imagecache.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "imagecache.h"
+
+//----------------------------------------------------------------------
+// SwapHeader
+// 	Do little endian to big endian conversion on the bytes in the
+//	object file header, in case the file was generated on a little
+//	endian machine, and we're now running on a big endian machine.
+//----------------------------------------------------------------------
+
+static void
+SwapHeader (NoffHeader *noffH)
+{
+    noffH->noffMagic = WordToHost(noffH->noffMagic);
+    noffH->code.size = WordToHost(noffH->code.size);
+    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
+    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
+    noffH->initData.size = WordToHost(noffH->initData.size);
+    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
+    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
+    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
+    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
+    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
+}
+
+//----------------------------------------------------------------------
+// FileVersionOf
+// 	Return the version of "executable" to check a cached image
+//	against.  Only the stub file system has one: the real one tells
+//	the cache itself when a file changes (cf. ImageCache::Invalidate).
+//----------------------------------------------------------------------
+
+static int
+FileVersionOf(OpenFile *executable)
+{
+#ifdef FILESYS_STUB
+    return executable->Version();
+#else
+    return 0;
+#endif
+}
+
+//----------------------------------------------------------------------
+// ImageCache::ImageCache
+// 	Initialize an empty cache.
+//----------------------------------------------------------------------
+
+ImageCache::ImageCache()
+{
+    images = NULL;
+    numImages = 0;
+    nextId = 0;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::~ImageCache
+// 	De-allocate the cache, and every image in it.
+//----------------------------------------------------------------------
+
+ImageCache::~ImageCache()
+{
+    while (images != NULL) {
+	ExecImage *image = images;
+	images = image->next;
+	delete [] image->contents;
+	delete image;
+    }
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Get
+// 	Return the image of "executable", with a reference for the
+//	caller.  A cached image whose file has changed length or version
+//	since it was read is stale, and is read again.
+//----------------------------------------------------------------------
+
+ExecImage *
+ImageCache::Get(OpenFile *executable)
+{
+    int key = executable->HeaderSector();
+    ExecImage *image;
+
+    for (image = images; image != NULL; image = image->next)
+	if (image->fileKey == key && image->fileLength == executable->Length()
+		&& image->version == FileVersionOf(executable)
+		&& image->contents != NULL)
+	    break;
+    if (image == NULL) {
+	if (numImages >= MaxCachedImages)
+	    Evict();
+	image = Load(executable);
+	image->next = images;
+	images = image;
+	numImages++;
+    } else
+	DEBUG('a', "Executable %d found in the image cache\n", key);
+    image->refCount++;
+    image->lastUsed = stats->totalTicks;
+    return image;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Release
+// 	An address space is done with "image".  It stays cached.
+//----------------------------------------------------------------------
+
+void
+ImageCache::Release(ExecImage *image)
+{
+    ASSERT(image->refCount > 0);
+    image->refCount--;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Invalidate
+// 	The executable whose header is in sector "fileKey" has been
+//	written or removed.  Its images are no longer found by Get; an
+//	image still in use stays until its address spaces are done with
+//	it, and Evict drops it then.
+//----------------------------------------------------------------------
+
+void
+ImageCache::Invalidate(int fileKey)
+{
+    for (ExecImage *image = images; image != NULL; image = image->next)
+	if (image->fileKey == fileKey) {
+	    DEBUG('a', "Executable %d changed; dropping its image\n", fileKey);
+	    image->fileKey = -1;
+	}
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Load
+// 	Read the NOFF header of "executable", and then its code and
+//	initialized data, into a new image.  Every image gets an id of
+//	its own, which its shared code pages are filed under.
+//----------------------------------------------------------------------
+
+ExecImage *
+ImageCache::Load(OpenFile *executable)
+{
+    ExecImage *image = new ExecImage;
+    NoffHeader *noffH = &image->noffH;
+
+    DEBUG('a', "Loading executable %d into the image cache\n",
+	  executable->HeaderSector());
+    executable->ReadAt((char *)noffH, sizeof(NoffHeader), 0);
+    if ((noffH->noffMagic != NOFFMAGIC) &&
+		(WordToHost(noffH->noffMagic) == NOFFMAGIC))
+    	SwapHeader(noffH);
+    ASSERT(noffH->noffMagic == NOFFMAGIC);
+
+    image->id = nextId++;
+    image->fileKey = executable->HeaderSector();
+    image->fileLength = executable->Length();
+    image->version = FileVersionOf(executable);
+    image->loadSize = noffH->code.size + noffH->initData.size;
+    image->contents = new char[image->loadSize > 0 ? image->loadSize : 1];
+    if (noffH->code.size > 0)
+	executable->ReadAt(image->contents, noffH->code.size,
+			   noffH->code.inFileAddr);
+    if (noffH->initData.size > 0)
+	executable->ReadAt(&image->contents[noffH->code.size],
+			   noffH->initData.size, noffH->initData.inFileAddr);
+    image->refCount = 0;
+    return image;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Evict
+// 	Drop the least recently used image that no address space is
+//	using, if there is one.  (If all are in use, the cache simply
+//	grows past MaxCachedImages for a while.)
+//----------------------------------------------------------------------
+
+void
+ImageCache::Evict()
+{
+    ExecImage **pp, **victim = NULL;
+
+    for (pp = &images; *pp != NULL; pp = &(*pp)->next)
+	if ((*pp)->refCount == 0
+		&& (victim == NULL || (*pp)->lastUsed < (*victim)->lastUsed))
+	    victim = pp;
+    if (victim == NULL)
+	return;
+    ExecImage *image = *victim;
+    *victim = image->next;
+    delete [] image->contents;
+    delete image;
+    numImages--;
+}
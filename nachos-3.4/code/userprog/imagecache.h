@@ -0,0 +1,79 @@
+// imagecache.h
+//	Data structures for caching parsed executables.
+//
+//	Starting a program means reading the NOFF header of its
+//	executable, and then its code and initialized data.  The image
+//	cache keeps the result, keyed by the sector of the executable's
+//	file header, so that running the same program again -- a shell
+//	Exec'ing the same command over and over -- needs no parsing and
+//	no reads at all.  Address spaces page their image in straight
+//	from the cached copy (cf. AddrSpace::ReadIn); code frames that are
+//	still resident are shared through the page cache (cf. pagecache.h).
+//
+//	Images are reference counted.  An unused image stays cached, until
+//	MaxCachedImages are cached and room is needed for another one.
+//
+//	The file system calls Invalidate when an executable is written or
+//	removed, since its header sector may then name a different program.
+//	With the stub file system, which does not know about the cache,
+//	Get instead notices that the UNIX file has been written since.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "copyright.h"
+#include "openfile.h"
+#include "noff.h"
+
+#define MaxCachedImages		8	// executables kept at once
+
+// The following class describes one parsed executable.
+
+class ExecImage {
+  public:
+    int id;			// unique, for the page cache
+    int fileKey;		// header sector of the executable
+    int fileLength;		// its length, to notice it has changed
+    int version;		// its OpenFile::Version, under the stub
+				// file system
+    NoffHeader noffH;		// the header, in host byte order
+    int loadSize;		// bytes of code and initialized data
+    char *contents;		// the code, then the initialized data,
+				// as laid out at virtual address 0
+    int refCount;		// address spaces using the image
+    int lastUsed;		// when it was last looked up
+    ExecImage *next;		// next image in the cache
+};
+
+// The following class defines the cache of executables.
+
+class ImageCache {
+  public:
+    ImageCache();
+    ~ImageCache();
+
+    ExecImage *Get(OpenFile *executable);
+				// Return the image of "executable",
+				// reading it if it is not cached; the
+				// caller holds a reference
+    void Release(ExecImage *image);
+				// Drop a reference
+    void Invalidate(int fileKey);
+				// The executable with header sector
+				// "fileKey" has changed, or is gone
+
+  private:
+    ExecImage *Load(OpenFile *executable);
+				// Parse and read an executable
+    void Evict();		// Make room by dropping an unused image
+
+    ExecImage *images;		// the cached images
+    int numImages;
+    int nextId;			// id of the next image read
+};
+
+#endif // IMAGECACHE_H
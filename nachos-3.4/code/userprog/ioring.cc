@@ -0,0 +1,334 @@
+// ioring.cc
+//	Routines for asynchronous I/O through a ring in user memory.  See
+//	ioring.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "syscall.h"
+#include "ioring.h"
+
+//----------------------------------------------------------------------
+// ReadWord/WriteWord
+// 	Fetch or store an integer in the memory of "space", converting
+//	between host and simulated byte order.  Return FALSE if "addr" is
+//	not in the address space.
+//----------------------------------------------------------------------
+
+static bool
+ReadWord(AddrSpace *space, int addr, int *value)
+{
+    unsigned int word;
+
+    if (!space->CopyIn(addr, (char *) &word, sizeof(word)))
+	return FALSE;
+    *value = WordToHost(word);
+    return TRUE;
+}
+
+static bool
+WriteWord(AddrSpace *space, int addr, int value)
+{
+    unsigned int word = WordToMachine((unsigned int) value);
+
+    return space->CopyOut((char *) &word, addr, sizeof(word));
+}
+
+//----------------------------------------------------------------------
+// IoContext::IoContext
+// 	Set up the kernel's side of the ring at "ringAddr", with
+//	"numEntries" slots in its submission ring at "sqAddr" and its
+//	completion ring at "cqAddr".  Both start out empty.
+//----------------------------------------------------------------------
+
+IoContext::IoContext(int ringAddr, int numEntries, int sqAddr, int cqAddr)
+{
+    ring = ringAddr;
+    entries = numEntries;
+    sq = sqAddr;
+    cq = cqAddr;
+    sqHead = cqTail = inFlight = 0;
+    lock = new Lock("io ring");
+    completed = new Condition("io completed");
+}
+
+IoContext::~IoContext()
+{
+    ASSERT(inFlight == 0);
+    delete completed;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// IoWorker
+// 	Body of a worker thread.  Need this to be a C routine, because
+//	C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+IoWorker(int arg)
+{
+    ((IoService *) arg)->Serve();
+}
+
+//----------------------------------------------------------------------
+// IoService::IoService
+// 	Initialize the request queue.  The workers are only forked when
+//	a program first uses a ring.
+//----------------------------------------------------------------------
+
+IoService::IoService()
+{
+    queue = new SynchList;
+    started = FALSE;
+}
+
+IoService::~IoService()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// IoService::Enter
+// 	The IoEnter system call, for a thread of "space".  The first call
+//	binds the ring at "ringAddr" to the address space; later ones
+//	must pass the same ring.
+//
+//	Takes up to "toSubmit" requests from the submission ring -- as
+//	many as are queued, and there is room for the completions of --
+//	then waits until at least "minComplete" completions are posted
+//	and not yet reaped, or nothing is left in flight.
+//
+//	Returns the number of requests taken, or -1 if the ring is not
+//	valid.
+//----------------------------------------------------------------------
+
+int
+IoService::Enter(AddrSpace *space, int ringAddr, int toSubmit, int minComplete)
+{
+    IoContext *ctx = space->io;
+    int sqTail, cqHead, submitted = 0;
+
+    if (ctx == NULL) {
+	int entries, sq, cq;
+	if (!ReadWord(space, ringAddr + RingEntries, &entries)
+		|| !ReadWord(space, ringAddr + RingSq, &sq)
+		|| !ReadWord(space, ringAddr + RingCq, &cq)
+		|| entries <= 0 || entries > MaxIoEntries
+		|| (entries & (entries - 1)) != 0
+		|| !WriteWord(space, ringAddr + RingSqHead, 0)
+		|| !WriteWord(space, ringAddr + RingCqTail, 0))
+	    return -1;
+	ctx = space->io = new IoContext(ringAddr, entries, sq, cq);
+    } else if (ringAddr != ctx->ring)
+	return -1;
+    if (!started) {
+	for (int i = 0; i < IoWorkers; i++)
+	    (new Thread("io worker"))->Fork(IoWorker, (int) this);
+	started = TRUE;
+    }
+
+    ctx->lock->Acquire();
+    if (!ReadWord(space, ringAddr + RingSqTail, &sqTail)
+	    || !ReadWord(space, ringAddr + RingCqHead, &cqHead)) {
+	ctx->lock->Release();
+	return -1;
+    }
+    while (submitted < toSubmit && ctx->sqHead != sqTail
+	    && (ctx->cqTail - cqHead) + ctx->inFlight < ctx->entries) {
+	int sqe = ctx->sq + (ctx->sqHead & (ctx->entries - 1)) * ReqSize;
+	IoWork *work = new IoWork;
+	work->space = space;
+	if (!ReadWord(space, sqe + ReqOpcode, &work->opcode)
+		|| !ReadWord(space, sqe + ReqFd, &work->fd)
+		|| !ReadWord(space, sqe + ReqBuf, &work->buf)
+		|| !ReadWord(space, sqe + ReqLength, &work->length)
+		|| !ReadWord(space, sqe + ReqOffset, &work->offset)
+		|| !ReadWord(space, sqe + ReqUserData, &work->userData)) {
+	    delete work;
+	    break;			// the ring itself is bad
+	}
+	ctx->sqHead++;
+	ctx->inFlight++;
+	submitted++;
+	Submit(space, work);
+    }
+    WriteWord(space, ringAddr + RingSqHead, ctx->sqHead);
+
+    while (ctx->inFlight > 0 && ReadWord(space, ringAddr + RingCqHead, &cqHead)
+	    && ctx->cqTail - cqHead < minComplete)
+	ctx->completed->Wait(ctx->lock);
+    ctx->lock->Release();
+    DEBUG('a', "IoEnter: %d submitted, %d in flight\n", submitted,
+	  ctx->inFlight);
+    return submitted;
+}
+
+//----------------------------------------------------------------------
+// IoService::Submit
+// 	Check a request and hand it to the workers.  A file request
+//	without an explicit offset (-1) gets the descriptor's position,
+//	which is advanced at once, as if the whole transfer succeeds.
+//	The address space, and the open file, are kept from going away
+//	until the request is done.  A bad request completes at once,
+//	with -1.  The caller holds the ring's lock.
+//----------------------------------------------------------------------
+
+void
+IoService::Submit(AddrSpace *space, IoWork *work)
+{
+    FileTableEntry *entry = NULL;
+    bool ok = work->length >= 0;
+
+    switch (work->opcode) {
+      case IO_READ:
+      case IO_WRITE:
+	entry = space->fileTable->Get(work->fd);
+	ok = ok && entry != NULL;
+	if (ok && entry->file != NULL && work->offset == -1) {
+	    work->offset = entry->position;
+	    entry->position += work->length;
+	}
+	ok = ok && (entry->file != NULL || work->fd ==
+		(work->opcode == IO_READ ? ConsoleInput : ConsoleOutput));
+	break;
+#ifdef NETWORK
+      case IO_SEND:
+      case IO_RECEIVE:
+	ok = ok && work->fd >= 0 && work->fd < postOffice->NumBoxes();
+	if (work->opcode == IO_SEND)
+	    ok = ok && work->length <= (int) MaxMailSize
+		&& (work->offset & 0xffff) < postOffice->NumBoxes();
+	break;
+#endif
+      default:
+	ok = FALSE;
+    }
+    if (!ok) {
+	Complete(space, work->userData, -1);
+	delete work;
+	return;
+    }
+    if (entry != NULL)
+	entry->pending++;
+    space->refCount++;
+    queue->Append((void *) work);
+}
+
+//----------------------------------------------------------------------
+// IoService::Serve
+// 	Loop forever, doing the requests put on the queue, and posting
+//	their completions.  If the program has exited meanwhile, the last
+//	request done for it deletes its address space.
+//----------------------------------------------------------------------
+
+void
+IoService::Serve()
+{
+    for (;;) {
+	IoWork *work = (IoWork *) queue->Remove();
+	AddrSpace *space = work->space;
+	int result = Perform(work);
+
+	if (work->opcode == IO_READ || work->opcode == IO_WRITE)
+	    space->fileTable->Get(work->fd)->pending--;
+	space->io->lock->Acquire();
+	Complete(space, work->userData, result);
+	space->io->lock->Release();
+	delete work;
+	if (--space->refCount == 0)
+	    delete space;
+    }
+}
+
+//----------------------------------------------------------------------
+// IoService::Perform
+// 	Carry out one request, moving its data between user memory and
+//	a kernel buffer a page at a time (cf. AddrSpace::CopyIn).  Return
+//	the number of bytes read or written, or -1 if the user buffer is
+//	not in the address space.  At most MaxIoLength bytes are moved.
+//----------------------------------------------------------------------
+
+int
+IoService::Perform(IoWork *work)
+{
+    AddrSpace *space = work->space;
+    int length = min(work->length, MaxIoLength);
+    char *buf = new char[max(length, 1)];
+    int result = -1;
+    OpenFile *file;
+
+    switch (work->opcode) {
+      case IO_READ:
+	file = space->fileTable->Get(work->fd)->file;
+	if (file == NULL)
+	    result = UserConsole()->Read(buf, length);
+	else
+	    result = file->ReadAt(buf, length, work->offset);
+	if (result > 0 && !space->CopyOut(buf, work->buf, result))
+	    result = -1;
+	break;
+      case IO_WRITE:
+	if (!space->CopyIn(work->buf, buf, length))
+	    break;
+	file = space->fileTable->Get(work->fd)->file;
+	if (file == NULL) {
+	    UserConsole()->Write(buf, length);
+	    result = length;
+	} else
+	    result = file->WriteAt(buf, length, work->offset);
+	break;
+#ifdef NETWORK
+      case IO_SEND: {
+	PacketHeader pktHdr;
+	MailHeader mailHdr;
+	if (!space->CopyIn(work->buf, buf, length))
+	    break;
+	pktHdr.to = (unsigned) work->offset >> 16;
+	mailHdr.to = work->offset & 0xffff;
+	mailHdr.from = work->fd;
+	mailHdr.length = length;
+	postOffice->Send(pktHdr, mailHdr, buf);
+	result = length;
+	break;
+      }
+      case IO_RECEIVE: {
+	PacketHeader pktHdr;
+	MailHeader mailHdr;
+	char data[MaxMailSize];
+	postOffice->Receive(work->fd, &pktHdr, &mailHdr, data);
+	result = min(length, (int) mailHdr.length);
+	if (!space->CopyOut(data, work->buf, result))
+	    result = -1;
+	break;
+      }
+#endif
+    }
+    delete [] buf;
+    return result;
+}
+
+//----------------------------------------------------------------------
+// IoService::Complete
+// 	Post a completion carrying "userData" and "result" to the ring
+//	of "space", and wake any thread waiting for it in Enter.  The
+//	entry is written before the tail is advanced past it, so the
+//	program never sees a half-written completion.
+//----------------------------------------------------------------------
+
+void
+IoService::Complete(AddrSpace *space, int userData, int result)
+{
+    IoContext *ctx = space->io;
+    int cqe = ctx->cq + (ctx->cqTail & (ctx->entries - 1)) * CqeSize;
+
+    WriteWord(space, cqe + CqeUserData, userData);
+    WriteWord(space, cqe + CqeResult, result);
+    ctx->cqTail++;
+    WriteWord(space, ctx->ring + RingCqTail, ctx->cqTail);
+    ctx->inFlight--;
+    ctx->completed->Broadcast(ctx->lock);
+}
@@ -0,0 +1,108 @@
+// ioring.h
+//	Data structures for asynchronous I/O by user programs.
+//
+//	A program sets up an IoRing (cf. syscall.h) in its own memory: a
+//	ring of requests it submits, and a ring of completions the kernel
+//	posts.  One IoEnter system call hands the kernel every request
+//	queued since the last one, and can wait for completions; the
+//	requests -- file, console and mailbox reads and writes -- are
+//	carried out by a pool of kernel worker threads, so that many can
+//	be outstanding at once, and the program only traps once for all
+//	of them.
+//
+//	The kernel owns the head of the submission ring and the tail of
+//	the completion ring; the program owns the other two indexes.  No
+//	more requests are taken than there is room for their completions,
+//	so the completion ring never overflows.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IORING_H
+#define IORING_H
+
+#include "copyright.h"
+#include "synch.h"
+#include "synchlist.h"
+
+class AddrSpace;
+
+#define IoWorkers	4		// kernel threads doing the I/O
+#define MaxIoEntries	256		// largest ring a program may use
+#define MaxIoLength	(16 * PageSize)	// most bytes moved per request
+
+// Layout of the IoRing, IoRequest and IoCompletion structures of
+// syscall.h in user memory: byte offsets of their fields.
+
+#define RingEntries	0
+#define RingSq		4
+#define RingCq		8
+#define RingSqHead	12
+#define RingSqTail	16
+#define RingCqHead	20
+#define RingCqTail	24
+
+#define ReqOpcode	0
+#define ReqFd		4
+#define ReqBuf		8
+#define ReqLength	12
+#define ReqOffset	16
+#define ReqUserData	20
+#define ReqSize		24
+
+#define CqeUserData	0
+#define CqeResult	4
+#define CqeSize		8
+
+// The kernel's side of a program's ring.
+
+class IoContext {
+  public:
+    IoContext(int ringAddr, int numEntries, int sqAddr, int cqAddr);
+    ~IoContext();
+
+    int ring;				// user address of the IoRing
+    int entries;			// slots in each ring
+    int sq, cq;				// user addresses of the two rings
+    int sqHead;				// next request to take
+    int cqTail;				// next completion slot
+    int inFlight;			// taken, but not yet completed
+    Lock *lock;				// protects all of the above
+    Condition *completed;		// signalled at each completion
+};
+
+// One request, taken from the submission ring, for a worker to do.
+
+class IoWork {
+  public:
+    AddrSpace *space;			// the program that asked
+    int opcode, fd, buf, length, offset, userData;
+};
+
+// The workers, and the queue of requests they take their work from.
+
+class IoService {
+  public:
+    IoService();
+    ~IoService();
+
+    int Enter(AddrSpace *space, int ringAddr, int toSubmit, int minComplete);
+					// Take up to "toSubmit" requests,
+					// then wait for "minComplete"
+					// completions to be posted
+    void Serve();			// Body of a worker thread
+
+  private:
+    void Submit(AddrSpace *space, IoWork *work);
+					// Queue a request, or fail it at once
+    int Perform(IoWork *work);		// Do one request; return its result
+    void Complete(AddrSpace *space, int userData, int result);
+					// Post a completion; caller holds
+					// the ring's lock
+
+    SynchList *queue;			// requests waiting for a worker
+    bool started;			// have the workers been forked?
+};
+
+#endif // IORING_H
@@ -0,0 +1,194 @@
+// pagecache.cc
+//	Routines to share read-only code frames between address spaces
+//	running the same executable.  See pagecache.h for the overall
+//	scheme.
+//
+//	The cache does not own the frames' contents -- the pager loads
+//	the page (Machine::PageIn) and then hands the frame over with
+//	Insert.  When the pager later picks a cached frame as its
+//	replacement victim, Evict invalidates every page table entry that
+//	still points at it.  Code pages are never written, so nothing has
+//	to be saved.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagecache.h"
+
+//----------------------------------------------------------------------
+// PageCache::PageCache
+// 	Initialize an empty cache of shared code frames.
+//----------------------------------------------------------------------
+
+PageCache::PageCache()
+{
+    int i;
+
+    buckets = new CachedPage *[PageCacheBuckets];
+    for (i = 0; i < PageCacheBuckets; i++)
+	buckets[i] = NULL;
+    frames = new CachedPage *[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+	frames[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// PageCache::~PageCache
+// 	De-allocate the cache.  The frames themselves belong to the
+//	machine, and go away with it.
+//----------------------------------------------------------------------
+
+PageCache::~PageCache()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+	if (frames[i] != NULL)
+	    delete frames[i];
+    delete [] frames;
+    delete [] buckets;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Hash
+// 	Choose the hash chain for <imageKey, pageIndex>.
+//----------------------------------------------------------------------
+
+int
+PageCache::Hash(int imageKey, int pageIndex)
+{
+    return ((unsigned) (imageKey * 31 + pageIndex)) % PageCacheBuckets;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Attach
+// 	Look up a code page.  If some frame already holds it, take a
+//	reference and return the frame number; otherwise return -1 and
+//	let the caller load the page.
+//
+//	"imageKey" -- id of the executable's image
+//	"pageIndex" -- virtual page number of the code page
+//----------------------------------------------------------------------
+
+int
+PageCache::Attach(int imageKey, int pageIndex)
+{
+    CachedPage *p;
+
+    for (p = buckets[Hash(imageKey, pageIndex)]; p != NULL; p = p->next)
+	if (p->imageKey == imageKey && p->pageIndex == pageIndex) {
+	    p->refCount++;
+	    DEBUG('a', "Sharing code page %d of image %d in frame %d, refs %d\n",
+		  pageIndex, imageKey, p->physPage, p->refCount);
+	    return p->physPage;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Insert
+// 	Remember that "physPage" now holds code page "pageIndex" of the
+//	executable image "imageKey".  The caller holds the first reference.
+//----------------------------------------------------------------------
+
+void
+PageCache::Insert(int imageKey, int pageIndex, int physPage)
+{
+    CachedPage *p = new CachedPage;
+    int bucket = Hash(imageKey, pageIndex);
+
+    ASSERT(frames[physPage] == NULL);
+    p->imageKey = imageKey;
+    p->pageIndex = pageIndex;
+    p->physPage = physPage;
+    p->refCount = 1;
+    p->next = buckets[bucket];
+    buckets[bucket] = p;
+    frames[physPage] = p;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Detach
+// 	An address space no longer maps a cached frame.  The frame stays
+//	resident, so that a later run of the same program can reuse it.
+//
+//	The identity of the page is checked, because the frame may have
+//	been evicted and recycled while the address space was not
+//	looking (for instance, while its thread was being torn down).
+//----------------------------------------------------------------------
+
+void
+PageCache::Detach(int physPage, int imageKey, int pageIndex)
+{
+    CachedPage *p = frames[physPage];
+
+    if (p == NULL || p->imageKey != imageKey || p->pageIndex != pageIndex)
+	return;
+    ASSERT(p->refCount > 0);
+    p->refCount--;
+}
+
+//----------------------------------------------------------------------
+// PageCache::IsCached
+// 	Return TRUE if "physPage" is a shared code frame.
+//----------------------------------------------------------------------
+
+bool
+PageCache::IsCached(int physPage)
+{
+    return frames[physPage] != NULL;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Evict
+// 	The pager is taking "physPage" away.  Invalidate the mapping in
+//	every address space that still uses it, and drop the frame from
+//	the cache.  The page is read-only, so there is nothing to write
+//	back; the next reference will simply fault it in again.
+//----------------------------------------------------------------------
+
+void
+PageCache::Evict(int physPage)
+{
+    CachedPage *p = frames[physPage];
+    CachedPage **pp;
+
+    ASSERT(p != NULL);
+    DEBUG('a', "Evicting shared code page %d of image %d from frame %d\n",
+	  p->pageIndex, p->imageKey, physPage);
+
+    for (int i = 0; i < MaxThreadNum; i++) {
+	Thread *t = threadsInfo[i];
+	if (t == NULL || t->space == NULL)
+	    continue;
+	TranslationEntry *entry = t->space->pageTable->Lookup(p->pageIndex);
+	if (entry != NULL && entry->valid && entry->physicalPage == physPage) {
+	    entry->valid = FALSE;
+	    t->space->usage.residentPages--;
+	}
+    }
+
+    for (pp = &buckets[Hash(p->imageKey, p->pageIndex)]; *pp != p;
+						pp = &(*pp)->next)
+	;
+    *pp = p->next;
+    frames[physPage] = NULL;
+    delete p;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Print
+// 	Print the cached code frames, for debugging.
+//----------------------------------------------------------------------
+
+void
+PageCache::Print()
+{
+    printf("Page cache contents:\n");
+    for (int i = 0; i < NumPhysPages; i++)
+	if (frames[i] != NULL)
+	    printf("frame %d: image %d, page %d, refs %d\n", i,
+		   frames[i]->imageKey, frames[i]->pageIndex,
+		   frames[i]->refCount);
+}
@@ -0,0 +1,71 @@
+// pagecache.h
+//	Data structures for sharing read-only code pages between
+//	address spaces that run the same executable.
+//
+//	Every physical frame holding a page of program code is entered
+//	in a hash table keyed by <executable image, page index>, the
+//	image being the copy of the program in the image cache (cf.
+//	ExecImage::id).  When another address space needs the same code
+//	page, it maps the cached frame (read-only) instead of loading one
+//	more copy of it into "mainMemory".  An executable that is
+//	rewritten gets a new image, so its old code is never shared with
+//	programs started after the change.
+//
+//	Frames are reference counted.  A frame whose count drops to zero
+//	stays in the cache, so that the next run of the program finds it
+//	resident, until the pager reclaims it for something else.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define PageCacheBuckets	31	// number of hash chains
+
+// The following class describes one cached code frame.
+
+class CachedPage {
+  public:
+    int imageKey;		// id of the executable's image
+    int pageIndex;		// virtual page number within the program
+    int physPage;		// frame in "mainMemory" holding the page
+    int refCount;		// number of address spaces mapping it
+    CachedPage *next;		// next entry on the same hash chain
+};
+
+// The following class defines the cache of shared code frames.
+
+class PageCache {
+  public:
+    PageCache();		// Initialize an empty cache
+    ~PageCache();		// De-allocate the cache
+
+    int Attach(int imageKey, int pageIndex);
+				// Return the frame holding the page and
+				// take a reference to it, or -1 if the
+				// page is not resident
+    void Insert(int imageKey, int pageIndex, int physPage);
+				// Enter a freshly loaded code frame, with
+				// one reference held by the caller
+    void Detach(int physPage, int imageKey, int pageIndex);
+				// Drop a reference; the frame stays cached
+    bool IsCached(int physPage);	// Does the cache own this frame?
+    void Evict(int physPage);	// The pager is reclaiming this frame:
+				// unmap it from every address space and
+				// forget about it
+
+    void Print();		// Print the contents of the cache
+
+  private:
+    int Hash(int imageKey, int pageIndex);
+
+    CachedPage **buckets;	// hash chains
+    CachedPage **frames;	// entry for each physical page, or NULL
+};
+
+#endif // PAGECACHE_H
@@ -0,0 +1,281 @@
+// pagetable.cc
+//	Routines to manage linear, two-level (radix) and hashed page
+//	tables.  See pagetable.h for a description of each.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pagetable.h"
+
+PageTableType pageTableType = LinearTable;
+
+//----------------------------------------------------------------------
+// InitEntry
+// 	Set up a fresh, invalid translation for virtual page "vpn".  The
+//	page has no copy in the backing store yet, so it will be zero
+//	filled when first touched.
+//----------------------------------------------------------------------
+
+static void
+InitEntry(TranslationEntry *entry, int vpn)
+{
+    entry->virtualPage = vpn;
+    entry->physicalPage = -1;
+    entry->valid = FALSE;
+    entry->readOnly = FALSE;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    entry->asid = 0;
+    entry->backingPage = -1;
+    entry->inTLBTime = 0;
+    entry->lastUsedTime = 0;
+}
+
+//----------------------------------------------------------------------
+// NewPageTable
+// 	Make a page table of the kind selected by "pageTableType".
+//
+//	"maxPages" -- number of pages in the whole virtual address space
+//----------------------------------------------------------------------
+
+PageTable *
+NewPageTable(int maxPages)
+{
+    switch (pageTableType) {
+      case RadixTable:
+	return new RadixPageTable(maxPages);
+      case HashedTable:
+	return new HashedPageTable();
+      default:
+	return new LinearPageTable(maxPages);
+    }
+}
+
+//----------------------------------------------------------------------
+// LinearPageTable::LinearPageTable
+// 	Allocate entries for pages [0, maxPages), all of them now: the
+//	fault handler and Prefetch keep pointers to entries while they
+//	create others, so the array must never move.
+//----------------------------------------------------------------------
+
+LinearPageTable::LinearPageTable(int maxPages)
+{
+    numEntries = (maxPages > 0) ? maxPages : 1;
+    table = new TranslationEntry[numEntries];
+    for (int i = 0; i < numEntries; i++)
+	InitEntry(&table[i], i);
+}
+
+LinearPageTable::~LinearPageTable()
+{
+    delete [] table;
+}
+
+//----------------------------------------------------------------------
+// LinearPageTable::Lookup
+// 	Index the table directly.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+LinearPageTable::Lookup(int vpn)
+{
+    if (vpn < 0 || vpn >= numEntries)
+	return NULL;
+    return &table[vpn];
+}
+
+//----------------------------------------------------------------------
+// LinearPageTable::Create
+// 	Every entry exists already; just index the table.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+LinearPageTable::Create(int vpn)
+{
+    ASSERT(vpn >= 0 && vpn < numEntries);
+    return &table[vpn];
+}
+
+void
+LinearPageTable::Mapcar(PTEFunctionPtr func, void *arg)
+{
+    for (int i = 0; i < numEntries; i++)
+	(*func)(&table[i], arg);
+}
+
+//----------------------------------------------------------------------
+// RadixPageTable::RadixPageTable
+// 	Allocate the top level only; leaves come as pages are touched.
+//----------------------------------------------------------------------
+
+RadixPageTable::RadixPageTable(int maxPages)
+{
+    dirSize = divRoundUp(maxPages, RadixLeafSize);
+    directory = new TranslationEntry *[dirSize];
+    for (int i = 0; i < dirSize; i++)
+	directory[i] = NULL;
+    numLeaves = 0;
+}
+
+RadixPageTable::~RadixPageTable()
+{
+    for (int i = 0; i < dirSize; i++)
+	if (directory[i] != NULL)
+	    delete [] directory[i];
+    delete [] directory;
+}
+
+//----------------------------------------------------------------------
+// RadixPageTable::Lookup
+// 	Walk the two levels: the high bits of "vpn" select the leaf, the
+//	low RadixLeafBits bits the entry within it.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+RadixPageTable::Lookup(int vpn)
+{
+    int dir = (unsigned) vpn >> RadixLeafBits;
+
+    if (vpn < 0 || dir >= dirSize || directory[dir] == NULL)
+	return NULL;
+    return &directory[dir][vpn & (RadixLeafSize - 1)];
+}
+
+TranslationEntry *
+RadixPageTable::Create(int vpn)
+{
+    int dir = (unsigned) vpn >> RadixLeafBits;
+
+    ASSERT(vpn >= 0 && dir < dirSize);
+    if (directory[dir] == NULL) {
+	TranslationEntry *leaf = new TranslationEntry[RadixLeafSize];
+	for (int i = 0; i < RadixLeafSize; i++)
+	    InitEntry(&leaf[i], (dir << RadixLeafBits) + i);
+	directory[dir] = leaf;
+	numLeaves++;
+    }
+    return &directory[dir][vpn & (RadixLeafSize - 1)];
+}
+
+void
+RadixPageTable::Mapcar(PTEFunctionPtr func, void *arg)
+{
+    for (int i = 0; i < dirSize; i++)
+	if (directory[i] != NULL)
+	    for (int j = 0; j < RadixLeafSize; j++)
+		(*func)(&directory[i][j], arg);
+}
+
+int
+RadixPageTable::Size()
+{
+    return dirSize * sizeof(TranslationEntry *)
+		+ numLeaves * RadixLeafSize * sizeof(TranslationEntry);
+}
+
+//----------------------------------------------------------------------
+// HashedPageTable::HashedPageTable
+// 	Start with a few empty chains.
+//----------------------------------------------------------------------
+
+HashedPageTable::HashedPageTable()
+{
+    numBuckets = HashInitialBuckets;
+    buckets = new HashedPTE *[numBuckets];
+    for (int i = 0; i < numBuckets; i++)
+	buckets[i] = NULL;
+    numEntries = 0;
+}
+
+HashedPageTable::~HashedPageTable()
+{
+    for (int i = 0; i < numBuckets; i++) {
+	HashedPTE *p = buckets[i];
+	while (p != NULL) {
+	    HashedPTE *next = p->next;
+	    delete p;
+	    p = next;
+	}
+    }
+    delete [] buckets;
+}
+
+TranslationEntry *
+HashedPageTable::Lookup(int vpn)
+{
+    for (HashedPTE *p = buckets[Hash(vpn)]; p != NULL; p = p->next)
+	if (p->entry.virtualPage == vpn)
+	    return &p->entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// HashedPageTable::Create
+// 	Return the entry for "vpn", adding one if there is none.  Keep
+//	the chains short by doubling the table once it holds twice as
+//	many entries as chains.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+HashedPageTable::Create(int vpn)
+{
+    TranslationEntry *entry = Lookup(vpn);
+
+    if (entry != NULL)
+	return entry;
+    if (numEntries >= 2 * numBuckets)
+	Grow();
+
+    HashedPTE *p = new HashedPTE;
+    int bucket = Hash(vpn);
+    InitEntry(&p->entry, vpn);
+    p->next = buckets[bucket];
+    buckets[bucket] = p;
+    numEntries++;
+    return &p->entry;
+}
+
+//----------------------------------------------------------------------
+// HashedPageTable::Grow
+// 	Double the number of chains, and redistribute the entries.  The
+//	entries themselves do not move, so pointers to them stay good.
+//----------------------------------------------------------------------
+
+void
+HashedPageTable::Grow()
+{
+    HashedPTE **oldBuckets = buckets;
+    int oldNumBuckets = numBuckets;
+
+    numBuckets *= 2;
+    buckets = new HashedPTE *[numBuckets];
+    for (int i = 0; i < numBuckets; i++)
+	buckets[i] = NULL;
+    for (int i = 0; i < oldNumBuckets; i++) {
+	HashedPTE *p = oldBuckets[i];
+	while (p != NULL) {
+	    HashedPTE *next = p->next;
+	    int bucket = Hash(p->entry.virtualPage);
+	    p->next = buckets[bucket];
+	    buckets[bucket] = p;
+	    p = next;
+	}
+    }
+    delete [] oldBuckets;
+}
+
+void
+HashedPageTable::Mapcar(PTEFunctionPtr func, void *arg)
+{
+    for (int i = 0; i < numBuckets; i++)
+	for (HashedPTE *p = buckets[i]; p != NULL; p = p->next)
+	    (*func)(&p->entry, arg);
+}
+
+int
+HashedPageTable::Size()
+{
+    return numBuckets * sizeof(HashedPTE *) + numEntries * sizeof(HashedPTE);
+}
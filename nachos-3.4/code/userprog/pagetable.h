@@ -0,0 +1,143 @@
+// pagetable.h
+//	Data structures for mapping the virtual pages of an address space
+//	to translation entries.
+//
+//	Three organizations are provided, chosen at start-up with the
+//	"-pt" flag:
+//
+//	  linear -- one entry per page of the whole address space,
+//		allocated up front.  Simple, but its size is that of the
+//		address space, so it only suits compact ones.
+//
+//	  radix -- a two-level table.  The top level has one pointer for
+//		each run of RadixLeafSize pages; a leaf is only allocated
+//		once a page in its run is used.
+//
+//	  hash -- entries for touched pages only, kept on hash chains
+//		keyed by virtual page number.  The table doubles its
+//		number of chains as it fills.
+//
+//	The radix and hashed tables only use memory for the pages that
+//	are actually touched, so a program can have a large, sparse
+//	address space (a heap grown with Sbrk, a stack at the top of the
+//	address space).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "translate.h"
+
+enum PageTableType { LinearTable, RadixTable, HashedTable };
+
+extern PageTableType pageTableType;	// organization used for new
+					// address spaces; set with -pt
+
+#define RadixLeafBits	9
+#define RadixLeafSize	(1 << RadixLeafBits)	// pages per leaf table
+#define HashInitialBuckets	16
+
+// Function applied to every entry by PageTable::Mapcar.
+
+typedef void (*PTEFunctionPtr)(TranslationEntry *entry, void *arg);
+
+// The following class defines the interface shared by every kind of
+// page table.  Entries are created on first use, marked invalid, with
+// "virtualPage" filled in and no backing store.
+
+class PageTable {
+  public:
+    virtual ~PageTable() {}
+
+    virtual TranslationEntry *Lookup(int vpn) = 0;
+					// Return the entry for "vpn", or NULL
+					// if the page was never touched
+    virtual TranslationEntry *Create(int vpn) = 0;
+					// Return the entry for "vpn",
+					// creating it if needed
+    virtual void Mapcar(PTEFunctionPtr func, void *arg) = 0;
+					// Apply "func" to every entry
+    virtual int NumEntries() = 0;	// Number of entries allocated
+    virtual int Size() = 0;		// Bytes used by the table itself
+};
+
+// A flat array of entries.  It never grows, so pointers to entries stay
+// valid for the life of the table.
+
+class LinearPageTable : public PageTable {
+  public:
+    LinearPageTable(int maxPages);	// Cover pages [0, maxPages)
+    ~LinearPageTable();
+
+    TranslationEntry *Lookup(int vpn);
+    TranslationEntry *Create(int vpn);
+    void Mapcar(PTEFunctionPtr func, void *arg);
+    int NumEntries() { return numEntries; }
+    int Size() { return numEntries * sizeof(TranslationEntry); }
+
+  private:
+    TranslationEntry *table;
+    int numEntries;
+};
+
+// A two-level table: "directory" points to leaves of RadixLeafSize
+// entries each.
+
+class RadixPageTable : public PageTable {
+  public:
+    RadixPageTable(int maxPages);	// Cover pages [0, maxPages)
+    ~RadixPageTable();
+
+    TranslationEntry *Lookup(int vpn);
+    TranslationEntry *Create(int vpn);
+    void Mapcar(PTEFunctionPtr func, void *arg);
+    int NumEntries() { return numLeaves * RadixLeafSize; }
+    int Size();
+
+  private:
+    TranslationEntry **directory;	// leaf for each run of pages, or NULL
+    int dirSize;			// number of slots in "directory"
+    int numLeaves;			// number of leaves allocated
+};
+
+// One entry of a hashed page table.
+
+class HashedPTE {
+  public:
+    TranslationEntry entry;
+    HashedPTE *next;			// next entry on the same chain
+};
+
+// A chained hash table of entries, keyed by virtual page number.
+
+class HashedPageTable : public PageTable {
+  public:
+    HashedPageTable();
+    ~HashedPageTable();
+
+    TranslationEntry *Lookup(int vpn);
+    TranslationEntry *Create(int vpn);
+    void Mapcar(PTEFunctionPtr func, void *arg);
+    int NumEntries() { return numEntries; }
+    int Size();
+
+  private:
+    int Hash(int vpn) { return (unsigned) vpn & (numBuckets - 1); }
+    void Grow();			// Double the number of chains
+
+    HashedPTE **buckets;
+    int numBuckets;			// always a power of two
+    int numEntries;
+};
+
+extern PageTable *NewPageTable(int maxPages);
+					// Make a table of the configured type
+					// for an address space of "maxPages"
+					// pages
+
+#endif // PAGETABLE_H
@@ -0,0 +1,195 @@
+// proctable.cc
+//  Routines to keep track of user programs, for Exec and Join.  See
+//  proctable.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "proctable.h"
+
+//----------------------------------------------------------------------
+// ProcessTable::ProcessTable
+//  Initialize an empty table.
+//----------------------------------------------------------------------
+
+ProcessTable::ProcessTable()
+{
+    for (int i = 0; i < MaxProcesses; i++) {
+        table[i].inUse = FALSE;
+        table[i].done = NULL;
+    }
+}
+
+ProcessTable::~ProcessTable()
+{
+    for (int i = 0; i < MaxProcesses; i++)
+        if (table[i].inUse)
+            delete table[i].done;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Add
+//  Take a free slot for a new program, started by "parent" (-1 for a
+//  program started from the command line).
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Add(int parent)
+{
+    for (int pid = 0; pid < MaxProcesses; pid++)
+        if (!table[pid].inUse) {
+            table[pid].inUse = TRUE;
+            table[pid].parent = parent;
+            table[pid].exited = FALSE;
+            table[pid].joined = FALSE;
+            table[pid].exitStatus = 0;
+            table[pid].done = new Semaphore("exit", 0);
+            table[pid].space = NULL;
+            table[pid].usage = Usage();
+            return pid;
+        }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Attach
+//  Record that program "pid" runs in "space", so that its usage can 
+//  be found.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Attach(int pid, AddrSpace *space)
+{
+    ASSERT(pid >= 0 && pid < MaxProcesses && table[pid].inUse);
+    table[pid].space = space;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Exit
+//  Record that program "pid" exited with "status", and save (and 
+//  print, for accounting) what it used.  Its children no longer have 
+//  anyone to Join them: those already done give back their slot now, 
+//  the others will when they exit.  Likewise, if nobody can Join 
+//  "pid", its own slot is freed at once.  A slot that a thread is 
+//  already waiting on in Join is left for that thread to free.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Exit(int pid, int status)
+{
+    char label[32];
+
+    ASSERT(pid >= 0 && pid < MaxProcesses && table[pid].inUse);
+    if (table[pid].space != NULL) {
+        table[pid].space->GetUsage(&table[pid].usage);
+        table[pid].usage.workingSet = table[pid].space->WorkingSetSize();
+        table[pid].space = NULL;
+    }
+    sprintf(label, "pid %d exit %d", pid, status);
+    table[pid].usage.Print(label);
+    for (int child = 0; child < MaxProcesses; child++)
+        if (table[child].inUse && table[child].parent == pid) {
+            table[child].parent = -1;
+            if (table[child].exited && !table[child].joined)
+                Free(child);
+        }
+    table[pid].exited = TRUE;
+    table[pid].exitStatus = status;
+    if (table[pid].parent == -1 && !table[pid].joined)
+        Free(pid);
+    else
+        table[pid].done->V();
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Join
+//  Wait for program "pid", a child of "parent", to exit, and return
+//  its exit status in "status".  Its slot is then freed: a program
+//  can be joined only once.  The slot is marked as being joined 
+//  before waiting, so that if another thread of the parent tries to 
+//  Join it meanwhile, that one fails rather than waiting on a 
+//  semaphore the first is about to delete.
+//----------------------------------------------------------------------
+
+bool
+ProcessTable::Join(int parent, int pid, int *status)
+{
+    if (pid < 0 || pid >= MaxProcesses || !table[pid].inUse
+            || table[pid].parent != parent || parent == -1
+            || table[pid].joined)
+        return FALSE;
+    table[pid].joined = TRUE;
+    table[pid].done->P();
+    *status = table[pid].exitStatus;
+    Free(pid);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::GetUsage
+//  Put what program "pid" has used into "usage": so far, if it is 
+//  still running, with its working set measured now; in all, if it 
+//  has exited but not been joined.  Return FALSE if there is no such 
+//  program.
+//----------------------------------------------------------------------
+
+bool
+ProcessTable::GetUsage(int pid, Usage *usage)
+{
+    if (pid < 0 || pid >= MaxProcesses || !table[pid].inUse)
+        return FALSE;
+    if (table[pid].space != NULL) {
+        table[pid].space->GetUsage(usage);
+        usage->workingSet = table[pid].space->WorkingSetSize();
+    } else
+        *usage = table[pid].usage;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Print
+//  List every program in the table, with what it has used, and under 
+//  each running one, its threads.
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Print()
+{
+    char label[32];
+    Usage usage;
+
+    printf("%-20s %7s %7s %6s %6s %6s %6s %5s %5s %5s %6s\n", "PROCESS", 
+           "USER", "SYSTEM", "FAULTS", "TLBMIS", "DISKRD", "DISKWR", "RSS", 
+           "MAXRS", "WSET", "CALLS");
+    for (int pid = 0; pid < MaxProcesses; pid++) {
+        if (!table[pid].inUse)
+            continue;
+        GetUsage(pid, &usage);
+        sprintf(label, "pid %d ppid %d %s", pid, table[pid].parent,
+                table[pid].exited ? "exited" : "run");
+        usage.Print(label);
+        for (int i = 0; table[pid].space != NULL && i < MaxThreadNum; i++) {
+            Thread *t = threadsInfo[i];
+            if (t == NULL || t->space != table[pid].space)
+                continue;
+            sprintf(label, "  tid %d %.12s", t->GetThreadID(), t->getName());
+            t->usage.Print(label);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Free
+//  Give back slot "pid".
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Free(int pid)
+{
+    delete table[pid].done;
+    table[pid].done = NULL;
+    table[pid].inUse = FALSE;
+}
@@ -0,0 +1,71 @@
+// proctable.h
+//  Data structures for the Exec and Join system calls.
+//
+//  Every user program started with Exec (or from the command line)
+//  gets a slot in the process table; the SpaceId that Exec returns is
+//  the index of the slot.  The slot outlives the program, holding its
+//  exit status until the parent Join's it.  A program whose parent
+//  has exited, or never had one, gives its slot back when it exits.
+//
+//  The table is also where the resources a program uses are found, 
+//  for GetUsage and the "ps" listing printed when Nachos halts: while 
+//  it runs, from its address space; once it has exited, from the 
+//  totals saved in its slot.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROCTABLE_H
+#define PROCTABLE_H
+
+#include "copyright.h"
+#include "synch.h"
+#include "stats.h"
+
+class AddrSpace;
+
+#define MaxProcesses    64      // programs that may exist at once,
+                                // counting those not yet joined
+
+class ProcessEntry {
+  public:
+    bool inUse;                 // is the slot taken?
+    int parent;                 // SpaceId of the parent, or -1
+    bool exited;                // has the program called Exit?
+    bool joined;                // is a thread of the parent waiting
+                                // in Join for it, or done waiting?
+    int exitStatus;             // what it passed to Exit
+    Semaphore *done;            // V'ed when it exits
+    AddrSpace *space;           // its address space, while it runs
+    Usage usage;                // what it used, once it has exited
+};
+
+class ProcessTable {
+  public:
+    ProcessTable();
+    ~ProcessTable();
+
+    int Add(int parent);        // Register a new program; return its
+                                // SpaceId, or -1 if the table is full
+    void Attach(int pid, AddrSpace *space);
+                                // Program "pid" runs in "space"
+    void Exit(int pid, int status);
+                                // Program "pid" is done; wake its
+                                // parent, and disown its children
+    bool Join(int parent, int pid, int *status);
+                                // Wait for child "pid" of "parent" to
+                                // exit; FALSE if it is not a child,
+                                // or another thread is joining it
+    bool GetUsage(int pid, Usage *usage);
+                                // What "pid" has used so far; FALSE 
+                                // if there is no such program
+    void Print();               // "ps": every program, and its threads
+
+  private:
+    void Free(int pid);         // Give back a slot
+
+    ProcessEntry table[MaxProcesses];
+};
+
+#endif // PROCTABLE_H
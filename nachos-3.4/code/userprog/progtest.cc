@@ -13,6 +13,7 @@
 #include "console.h"
 #include "addrspace.h"
 #include "synch.h"
+#include "checkpoint.h"
 
 //----------------------------------------------------------------------
 // StartProcess
@@ -84,6 +85,9 @@ StartProcess(char *filename)
 	return;
     }
     space = new AddrSpace(executable);    
+    space->SetExecName(filename);
+    space->pid = processTable->Add(-1);     // may Exec and Join others
+    processTable->Attach(space->pid, space);
     currentThread->space = space;
 
     delete executable;			// close file 留到Finish的时候在关闭文件
@@ -99,6 +103,23 @@ StartProcess(char *filename)
 					// by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// RestoreProcess
+// 	Run a user program from the checkpoint it saved in "file" (cf.
+//	the Checkpoint system call), as if it had never stopped.
+//----------------------------------------------------------------------
+
+void
+RestoreProcess(char *file)
+{
+    if (!RestoreCheckpoint(file)) {
+	printf("Unable to restore checkpoint %s\n", file);
+	return;
+    }
+    machine->Run();			// back into the user program
+    ASSERT(FALSE);
+}
+
 // Data structures needed for the console test.  Threads making
 // I/O requests wait on a Semaphore to delay until the I/O completes.
 
@@ -0,0 +1,216 @@
+// synchconsole.cc
+//  Routines to access the console synchronously.  See synchconsole.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "synchconsole.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ConsoleReadAvail/ConsoleWriteDone
+//  Console interrupt handlers.  Need these to be C routines, because
+//  C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+ConsoleReadAvail(int arg)
+{
+    ((SynchConsole *) arg)->ReadAvail();
+}
+
+static void
+ConsoleWriteDone(int arg)
+{
+    ((SynchConsole *) arg)->WriteDone();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::SynchConsole
+//  Initialize the synchronous interface to the console.
+//
+//  "readFile", "writeFile" -- UNIX files simulating the keyboard and
+//      the display; NULL for stdin and stdout
+//----------------------------------------------------------------------
+
+SynchConsole::SynchConsole(char *readFile, char *writeFile)
+{
+    readAvail = new Semaphore("console read", 0);
+    outputDone = new Semaphore("console write", 0);
+    readLock = new Lock("console reader");
+    writeLock = new Lock("console writer");
+    outHead = outCount = inFlight = 0;
+    readerWaiting = writerWaiting = FALSE;
+    console = new Console(readFile, writeFile, ConsoleReadAvail,
+                          ConsoleWriteDone, (int) this);
+}
+
+SynchConsole::~SynchConsole()
+{
+    delete console;
+    delete writeLock;
+    delete readLock;
+    delete outputDone;
+    delete readAvail;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Read
+//  Take up to "numBytes" characters from the device's input buffer
+//  into "into", stopping after a newline.  Waits for at least one
+//  character; after that, takes only what has already come in.
+//----------------------------------------------------------------------
+
+int
+SynchConsole::Read(char *into, int numBytes)
+{
+    int i = 0;
+
+    readLock->Acquire();
+    if (numBytes > 0) {
+        while (console->NumAvail() == 0) {
+            readerWaiting = TRUE;
+            readAvail->P();
+        }
+        while (i < numBytes && console->NumAvail() > 0) {
+            into[i++] = console->GetChar();
+            if (into[i - 1] == '\n')
+                break;
+        }
+    }
+    readLock->Release();
+    return i;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Write/WriteLine
+//  Queue text for the display, and return once it is all in the ring
+//  (not necessarily out yet).  WriteLine adds the newline.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Write(char *from, int numBytes)
+{
+    writeLock->Acquire();
+    Queue(from, numBytes);
+    writeLock->Release();
+}
+
+void
+SynchConsole::WriteLine(char *line)
+{
+    char newline = '\n';
+
+    writeLock->Acquire();
+    Queue(line, strlen(line));
+    Queue(&newline, 1);
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Flush
+//  Wait until everything queued has been written, e.g. before Nachos
+//  halts.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Flush()
+{
+    writeLock->Acquire();
+    while (outCount > 0) {
+        writerWaiting = TRUE;
+        outputDone->P();
+    }
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Queue
+//  Copy "numBytes" characters into the ring, starting a transfer if
+//  the device is idle, and waiting for one to finish whenever the
+//  ring is full.  The caller holds writeLock.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Queue(char *from, int numBytes)
+{
+    while (numBytes > 0) {
+        if (outCount == ConsoleRingSize) {
+            writerWaiting = TRUE;
+            outputDone->P();
+            continue;
+        }
+        int tail = (outHead + outCount) % ConsoleRingSize;
+        int n = min(numBytes, min(ConsoleRingSize - outCount,
+                                  ConsoleRingSize - tail));
+        bcopy(from, &ring[tail], n);
+        outCount += n;
+        from += n;
+        numBytes -= n;
+        StartOutput();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::StartOutput
+//  If the device is idle, give it all the queued text that is
+//  contiguous in the ring.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::StartOutput()
+{
+    if (inFlight > 0 || outCount == 0)
+        return;
+    inFlight = min(outCount, ConsoleRingSize - outHead);
+    console->PutChars(&ring[outHead], inFlight);
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::ReadAvail/WriteDone
+//  Interrupt handlers.  ReadAvail wakes a waiting reader (the device
+//  calls it for every character that comes in).  WriteDone
+//  frees the space of the text just written, starts on whatever was
+//  queued meanwhile, and wakes a writer waiting for room.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::ReadAvail()
+{
+    if (readerWaiting) {
+        readerWaiting = FALSE;
+        readAvail->V();
+    }
+}
+
+void
+SynchConsole::WriteDone()
+{
+    outHead = (outHead + inFlight) % ConsoleRingSize;
+    outCount -= inFlight;
+    inFlight = 0;
+    StartOutput();
+    if (writerWaiting) {
+        writerWaiting = FALSE;
+        outputDone->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// UserConsole
+//  Return the console used by descriptors ConsoleInput and 
+//  ConsoleOutput.  It is started on first use: once it runs, there 
+//  are always interrupts pending, so Nachos no longer halts by itself 
+//  when the last program finishes -- a program that uses the console 
+//  must call Halt.
+//----------------------------------------------------------------------
+
+SynchConsole *
+UserConsole()
+{
+    if (synchConsole == NULL)
+        synchConsole = new SynchConsole(NULL, NULL);
+    return synchConsole;
+}
@@ -0,0 +1,76 @@
+// synchconsole.h
+//  Data structures to export a synchronous interface to the console
+//  device, for the Read and Write system calls.
+//
+//  As with the disk (cf. synchdisk.h), the raw console is asynchronous:
+//  an interrupt says when output has gone out, and when input has come
+//  in.  A SynchConsole makes a reader wait for input, and lets only
+//  one thread read, and one write, at a time, so that the text of
+//  concurrent Write's is not interleaved.
+//
+//  Output goes through a ring buffer of ConsoleRingSize characters.
+//  Write copies its text into the ring and returns, only waiting if
+//  the ring is full; the ring is drained with one PutChars (one UNIX
+//  write, one interrupt) for everything queued while the previous
+//  transfer was in flight.  Input is taken from the device's buffer
+//  as a whole line, or all there is, per wakeup.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHCONSOLE_H
+#define SYNCHCONSOLE_H
+
+#include "copyright.h"
+#include "console.h"
+#include "synch.h"
+
+#define ConsoleRingSize 1024    // characters of output queued at most
+
+class SynchConsole {
+  public:
+    SynchConsole(char *readFile, char *writeFile);
+                                // Initialize the console; NULL names
+                                // mean stdin and stdout
+    ~SynchConsole();
+
+    int Read(char *into, int numBytes);
+                                // Read the characters that have come
+                                // in, up to the end of the line or
+                                // "numBytes"; waits for at least one.
+                                // Return the number read
+    void Write(char *from, int numBytes);
+                                // Queue "numBytes" characters
+    void WriteLine(char *line); // Queue a string and a newline, as
+                                // one piece of text
+    void Flush();               // Wait until all queued output is out
+
+    void ReadAvail();           // Called by the console interrupt
+    void WriteDone();           // handlers
+
+  private:
+    void Queue(char *from, int numBytes);
+                                // Copy into the ring, waiting for room
+    void StartOutput();         // Hand the queued text to the device
+
+    Console *console;
+    Semaphore *readAvail;       // V'ed when characters come in and
+                                // a reader is waiting for them
+    Semaphore *outputDone;      // V'ed when a transfer completes and
+                                // a writer is waiting for it
+    Lock *readLock;             // One reader at a time
+    Lock *writeLock;            // One writer at a time
+
+    char ring[ConsoleRingSize]; // queued output: "outCount" characters
+    int outHead;                // starting at "outHead", the first
+    int outCount;               // "inFlight" of them being written
+    int inFlight;
+    bool readerWaiting;         // is a reader waiting for input?
+    bool writerWaiting;         // is a writer waiting for a transfer?
+};
+
+extern SynchConsole *UserConsole();
+                                // The console of user programs
+
+#endif // SYNCHCONSOLE_H
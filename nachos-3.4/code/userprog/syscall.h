@@ -30,6 +30,23 @@
 #define SC_Fork		9
 #define SC_Yield	10
 #define SC_Print                         11
+#define SC_Sbrk		12
+#define SC_FutexWait	13
+#define SC_FutexWake	14
+#define SC_IoEnter	15
+#define SC_Mmap		16
+#define SC_Munmap	17
+#define SC_GetUsage	18
+#define SC_SetLimit	19
+#define SC_Checkpoint	20
+
+#define NumSyscallCodes	32	/* codes counted in ProcessUsage */
+
+/* Operations of asynchronous I/O requests (cf. IoEnter) */
+#define IO_READ		0
+#define IO_WRITE	1
+#define IO_SEND		2	/* mailboxes; only with the network */
+#define IO_RECEIVE	3
 
 #ifndef IN_ASM
 
@@ -56,12 +73,12 @@ void Exit(int status);
 typedef int SpaceId;	
  
 /* Run the executable, stored in the Nachos file "name", and return the 
- * address space identifier
+ * address space identifier, or -1 if it cannot be run
  */
 SpaceId Exec(char *name);
  
 /* Only return once the the user program "id" has finished.  
- * Return the exit status.
+ * Return the exit status, or -1 if "id" was not Exec'ed by the caller.
  */
 int Join(SpaceId id); 	
  
@@ -87,16 +104,21 @@ typedef int OpenFileId;
 #define ConsoleInput	0  
 #define ConsoleOutput	1  
  
-/* Create a Nachos file, with "name" */
-void Create(char *name);
+/* Create a Nachos file, with "name".  Return 0, or -1 if it could not
+ * be created.
+ */
+int Create(char *name);
 
 /* Open the Nachos file "name", and return an "OpenFileId" that can 
- * be used to read and write to the file.
+ * be used to read and write to the file, or -1 if there is no such
+ * file (or the program has too many files open).
  */
 OpenFileId Open(char *name);
 
-/* Write "size" bytes from "buffer" to the open file. */
-void Write(char *buffer, int size, OpenFileId id);
+/* Write "size" bytes from "buffer" to the open file.  Return the number
+ * of bytes written, or -1 if "id" is not open or "buffer" is bad.
+ */
+int Write(char *buffer, int size, OpenFileId id);
 
 /* Read "size" bytes from the open file into "buffer".  
  * Return the number of bytes actually read -- if the open file isn't
@@ -116,9 +138,11 @@ void Close(OpenFileId id);
  */
 
 /* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+ * as the current thread, on a stack of its own.  Return 0, or -1 if the
+ * program has too many threads.  "func" must end by calling Exit; the
+ * program is done when its last thread exits.
  */
-void Fork(void (*func)());
+int Fork(void (*func)());
 
 /* Yield the CPU to another runnable thread, whether in this address space 
  * or not. 
@@ -126,6 +150,132 @@ void Fork(void (*func)());
 void Yield();		
 
 void Print(int value);
+
+/* Grow the heap by "increment" bytes (shrink it, if negative).  Return
+ * the old end of the heap -- the start of the new memory -- or -1 if
+ * there is no room.
+ */
+int Sbrk(int increment);
+
+/* Synchronization between the threads of a program.  A lock is a word 
+ * of user memory, updated with CompareAndSwap, which is done in user 
+ * mode with the LL and SC instructions: taking a free lock and releasing
+ * one nobody waits for need no system call.  Under contention:
+ */
+
+/* Atomically, if *addr == oldValue, set it to newValue.  Return what 
+ * *addr held before (the swap was done if that is "oldValue").  Not a
+ * system call.
+ */
+int CompareAndSwap(int *addr, int oldValue, int newValue);
+
+/* Sleep until woken by FutexWake on "addr", unless *addr no longer holds
+ * "value".  Return 0 after being woken, -1 if *addr had changed.
+ */
+int FutexWait(int *addr, int value);
+
+/* Wake up to "count" threads waiting in FutexWait on "addr".  Return 
+ * how many were woken.
+ */
+int FutexWake(int *addr, int count);
+
+/* Asynchronous I/O.  The program keeps an IoRing in its memory, with a
+ * ring of "entries" requests and a ring of "entries" completions 
+ * ("entries" is a power of two, at most 256).  Slot i of a ring is at 
+ * index i % entries; the head and tail indexes only ever grow.  The 
+ * program fills in requests at sq[sqTail], then advances sqTail; the 
+ * kernel posts their completions at cq[cqTail], in the order they finish,
+ * and the program reaps them from cqHead.
+ */
+typedef struct {
+    int opcode;		/* IO_READ, IO_WRITE, IO_SEND or IO_RECEIVE */
+    int fd;		/* open file, or for IO_SEND/IO_RECEIVE, mailbox */
+    char *buf;		/* the data */
+    int length;		/* its size, in bytes */
+    int offset;		/* where in the file, or -1 for the descriptor's 
+			 * position; for IO_SEND, (machine << 16) | mailbox */
+    int userData;	/* handed back in the completion */
+} IoRequest;
+
+typedef struct {
+    int userData;	/* from the request */
+    int result;		/* bytes moved, or -1 */
+} IoCompletion;
+
+typedef struct {
+    int entries;	/* set by the program, before the first IoEnter */
+    IoRequest *sq;
+    IoCompletion *cq;
+    int sqHead;		/* next request the kernel takes (kernel's) */
+    int sqTail;		/* next free request slot (program's) */
+    int cqHead;		/* next completion to reap (program's) */
+    int cqTail;		/* next free completion slot (kernel's) */
+} IoRing;
+
+/* Submit up to "toSubmit" of the queued requests of "ring", then wait 
+ * until at least "minComplete" completions are ready to reap (or none 
+ * are still in flight).  Return the number submitted, or -1 if the ring
+ * is not valid.  A program has one ring; a file with requests in flight
+ * cannot be closed.
+ */
+int IoEnter(IoRing *ring, int toSubmit, int minComplete);
+
+/* Map "length" bytes of open file "fd", from "offset" on, into the 
+ * address space.  Pages are read from the file when first touched, and 
+ * what the program writes to them goes back to the file -- at the 
+ * latest when it calls Munmap, or exits.  Return the address of the 
+ * mapping, or -1.  A mapped file cannot be closed.
+ */
+int Mmap(OpenFileId fd, int offset, int length);
+
+/* Remove the mapping at "addr", as returned by Mmap, saving what was 
+ * written to it.  Return 0, or -1 if there is no mapping at "addr".
+ */
+int Munmap(char *addr);
+
+/* What a program, or a thread, has used.  Times are in ticks; disk I/O
+ * is in sectors.
+ */
+typedef struct {
+    int userTicks;		/* user instructions executed */
+    int systemTicks;		/* time in the kernel */
+    int pageFaults;
+    int tlbMisses;
+    int diskReads;
+    int diskWrites;
+    int residentPages;		/* pages in memory now (programs only) */
+    int maxResident;		/* ... and at most */
+    int workingSet;		/* pages in memory and used lately */
+    int syscalls[NumSyscallCodes];	/* calls made, by SC_ code */
+} ProcessUsage;
+
+#define USAGE_PROCESS	-1	/* "who" for the caller's own program */
+#define USAGE_THREAD	-2	/* ... for the calling thread alone */
+
+/* Fill in "usage" with what "who" has used so far: USAGE_PROCESS, 
+ * USAGE_THREAD, or the SpaceId of a program, running or exited but not 
+ * yet joined.  Return 0, or -1 if there is no such program.
+ */
+int GetUsage(SpaceId who, ProcessUsage *usage);
+
+/* Resources that may be limited */
+#define LIMIT_CPU	0	/* ticks of user and system time */
+#define LIMIT_RESIDENT	1	/* pages in memory, at least 4 */
+
+/* Limit "resource" of the program, and of those it Exec's from now on,
+ * to "value"; 0 means no limit.  A program over its CPU limit is 
+ * stopped, with exit status -1; one at its resident limit pages 
+ * against itself.  Return the old limit, or -1.
+ */
+int SetLimit(int resource, int value);
+
+/* Save the program to the file "name", to be run again from this point 
+ * with "nachos -rx name" -- any number of times, by later runs of 
+ * Nachos.  Return 0 once saved, and 1 when running again from the 
+ * checkpoint; -1 if the program cannot be saved: only one with a single
+ * thread, and no file but the console open, mapped or in an I/O ring.
+ */
+int Checkpoint(char *name);
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */